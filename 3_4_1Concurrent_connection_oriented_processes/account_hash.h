@@ -0,0 +1,35 @@
+#ifndef ACCOUNT_HASH_H
+#define ACCOUNT_HASH_H
+
+#include "shared_accounts.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// FNV-1a for the shared table's index and lock stripes and for the
+// snapshot checksums; snapshots on disk depend on these values
+
+#define FNV1A_INIT 2166136261u
+#define FNV1A_PRIME 16777619u
+
+// Continues h over len bytes; start from FNV1A_INIT
+static inline uint32_t fnv1a(uint32_t h, const void* data, size_t len) {
+    const unsigned char* p = data;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= p[i];
+        h *= FNV1A_PRIME;
+    }
+    return h;
+}
+
+// Stops at the NUL or the end of SharedAccount.account_no, which a full
+// 16-digit number leaves unterminated
+static inline uint32_t hash_account_no(const char* account_no) {
+    uint32_t h = FNV1A_INIT;
+    for (size_t i = 0; i < sizeof(((SharedAccount*)0)->account_no) && account_no[i]; ++i) {
+        h ^= (unsigned char)account_no[i];
+        h *= FNV1A_PRIME;
+    }
+    return h;
+}
+
+#endif // ACCOUNT_HASH_H
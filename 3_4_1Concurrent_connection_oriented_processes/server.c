@@ -1,5 +1,8 @@
 /* server.c - Fork-based concurrent server */
 #include "common.h"
+#include "acct_alloc.h"
+#include "txn_log.h"
+#include "shared_accounts.h"
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <fcntl.h>
@@ -10,17 +13,9 @@
 #include <errno.h>
 #include <ctype.h>
 #include <time.h>
+#include <float.h>
+#include <unistd.h>
 
-#ifdef _WIN32
-    #include <windows.h>
-    #include <io.h>
-    #include <fcntl.h>
-    #undef fileno
-    #define fileno _fileno
-#else
-    #include <unistd.h>
-    #include <sys/file.h>
-#endif
 // Business Logic Functions - will move to server.c in future versions
 char* process_request(const char* request);
 char* register_account(const char* account_no);
@@ -45,10 +40,7 @@ bool withdraw_extended(const char* account_no, const char* pin, double amount);
 bool deposit_extended(const char* account_no, const char* pin, double amount);
 bool balance(const char* account_no, double* out_balance);
 bool statement(const char* account_no, const char* pin, char transactions[5][MAX_LINE_LEN]);
-void log_transaction(const char* account_no, const char* type, double amount, double balance);
-// Add these prototypes
-static void lock_file(FILE* file, bool exclusive);
-static void unlock_file(FILE* file);
+void log_transaction(const char* account_no, TxnOp op, double amount, double balance);
 bool check_pin(const char* account_no, const char* pin);
 
 int main() {
@@ -56,6 +48,20 @@ int main() {
     struct sockaddr_in server_addr, client_addr;
     socklen_t client_len = sizeof(client_addr);
 
+    // Loaded once here; every child inherits the table instead of rescanning
+    // data.txt per request
+    if (!shared_open(DB_FILENAME)) {
+        fprintf(stderr, "Failed to load accounts from %s\n", DB_FILENAME);
+        exit(1);
+    }
+
+    // Each child serves one connection and exits, so it leases a single
+    // number; a larger block would mostly be thrown away
+    if (!acct_alloc_init(ACCT_SEQ_FILENAME, shared_max_account_no() + 1, 1)) {
+        fprintf(stderr, "Failed to open account number counter %s\n", ACCT_SEQ_FILENAME);
+        exit(1);
+    }
+
     server_sock = socket(AF_INET, SOCK_STREAM, 0);
     if (server_sock < 0) {
         perror("socket");
@@ -254,17 +260,10 @@ char* deposit(const char* account_no, double amount) {
     if (!is_valid_amount(amount)) {
         return create_response(RESP_INVALID_AMOUNT, 0);
     }
-    if (!account_exists(account_no)) {
-        return create_response(RESP_ACCT_NOT_FOUND, 0);
-    }
-    if (!get_balance(account_no, &balance)) {
-        return create_response(RESP_ERROR, 0);
-    }
-    balance += amount;
-    if (update_balance(account_no, balance)) {
-        return create_response(RESP_OK, balance);
-    } else {
-        return create_response(RESP_ERROR, 0);
+    switch (shared_apply_delta(account_no, NULL, amount, -DBL_MAX, &balance, NULL, NULL)) {
+        case SHARED_OK: return create_response(RESP_OK, balance);
+        case SHARED_NOT_FOUND: return create_response(RESP_ACCT_NOT_FOUND, 0);
+        default: return create_response(RESP_ERROR, 0);
     }
 }
 
@@ -273,20 +272,11 @@ char* withdraw(const char* account_no, double amount) {
     if (!is_valid_amount(amount)) {
         return create_response(RESP_INVALID_AMOUNT, 0);
     }
-    if (!account_exists(account_no)) {
-        return create_response(RESP_ACCT_NOT_FOUND, 0);
-    }
-    if (!get_balance(account_no, &balance)) {
-        return create_response(RESP_ERROR, 0);
-    }
-    if (balance < amount) {
-        return create_response(RESP_INSUFFICIENT_FUNDS, balance);
-    }
-    balance -= amount;
-    if (update_balance(account_no, balance)) {
-        return create_response(RESP_OK, balance);
-    } else {
-        return create_response(RESP_ERROR, 0);
+    switch (shared_apply_delta(account_no, NULL, -amount, 0, &balance, NULL, NULL)) {
+        case SHARED_OK: return create_response(RESP_OK, balance);
+        case SHARED_NOT_FOUND: return create_response(RESP_ACCT_NOT_FOUND, 0);
+        case SHARED_INSUFFICIENT_FUNDS: return create_response(RESP_INSUFFICIENT_FUNDS, balance);
+        default: return create_response(RESP_ERROR, 0);
     }
 }
 
@@ -303,112 +293,38 @@ char* check_balance(const char* account_no) {
 }
 
 bool account_exists(const char* account_no) {
-    FILE* file = fopen(DB_FILENAME, "r");
-    if (!file) {
-        // File doesn't exist, no accounts exist
-        return false;
-    }
-    char line[MAX_LINE_LEN];
-    char file_acct[MAX_ACCT_LEN];
-    bool found = false;
-    lock_file(file, false); // lock for reading
-    while (fgets(line, MAX_LINE_LEN, file)) {
-        if (sscanf(line, "%s", file_acct) == 1) {
-            if (strcmp(file_acct, account_no) == 0) {
-                found = true;
-                break;
-            }
-        }
-    }
-    unlock_file(file);
-    fclose(file);
-    return found;
+    SharedAccount account;
+    return shared_get(account_no, &account);
 }
 
 bool get_balance(const char* account_no, double* balance) {
-    FILE* file = fopen(DB_FILENAME, "r");
-    if (!file) {
-        return false;
-    }
-    char line[MAX_LINE_LEN];
-    char file_acct[MAX_ACCT_LEN];
-    double file_balance;
-    bool found = false;
-    lock_file(file, false); // lock for reading
-    while (fgets(line, MAX_LINE_LEN, file)) {
-        // Skip to the 6th field (balance)
-        if (sscanf(line, "%s %*s %*s %*s %*s %lf", file_acct, &file_balance) == 2) {
-            if (strcmp(file_acct, account_no) == 0) {
-                *balance = file_balance;
-                found = true;
-                break;
-            }
-        }
-    }
-    unlock_file(file);
-    fclose(file);
-    return found;
+    SharedAccount account;
+    if (!shared_get(account_no, &account)) return false;
+    *balance = account.balance;
+    return true;
 }
 
 bool update_balance(const char* account_no, double new_balance) {
-    FILE* file = fopen(DB_FILENAME, "r");
-    if (!file) {
-        return false;
-    }
-    FILE* temp = fopen("temp.txt", "w");
-    if (!temp) {
-        fclose(file);
-        return false;
-    }
-    char line[MAX_LINE_LEN];
-    char file_acct[MAX_ACCT_LEN], file_pin[8], name[64], national_id[32], account_type[16];
-    double file_balance;
-    bool updated = false;
-    lock_file(file, true);
-    lock_file(temp, true);
-    while (fgets(line, MAX_LINE_LEN, file)) {
-        if (sscanf(line, "%s %s %s %s %s %lf", file_acct, file_pin, name, national_id, account_type, &file_balance) == 6) {
-            if (strcmp(file_acct, account_no) == 0) {
-                fprintf(temp, "%s %s %s %s %s %.2f\n", file_acct, file_pin, name, national_id, account_type, new_balance);
-                updated = true;
-            } else {
-                fputs(line, temp);
-            }
-        } else {
-            fputs(line, temp);
-        }
-    }
-    unlock_file(file);
-    unlock_file(temp);
-    fclose(file);
-    fclose(temp);
-    if (remove(DB_FILENAME) != 0) {
-        perror("Error removing file");
-        return false;
-    }
-    if (rename("temp.txt", DB_FILENAME) != 0) {
-        perror("Error renaming file");
-        return false;
-    }
-    return updated;
+    return shared_set_balance(account_no, new_balance);
+}
+
+// Fills every field, so the record written back to data.txt is well formed
+static bool insert_account(const char* account_no, const char* pin, const char* name,
+                           const char* national_id, const char* account_type, double balance) {
+    SharedAccount account;
+    memset(&account, 0, sizeof(account));
+    snprintf(account.account_no, sizeof(account.account_no), "%s", account_no);
+    snprintf(account.pin, sizeof(account.pin), "%s", pin);
+    snprintf(account.name, sizeof(account.name), "%s", name);
+    snprintf(account.national_id, sizeof(account.national_id), "%s", national_id);
+    snprintf(account.account_type, sizeof(account.account_type), "%s", account_type);
+    account.balance = balance;
+    return shared_insert(&account);
 }
 
 bool add_account(const char* account_no, const char* pin, double initial_balance) {
-    FILE* file = fopen(DB_FILENAME, "a+");
-    if (!file) {
-        file = fopen(DB_FILENAME, "w");
-        if (!file) {
-            perror("Error creating database file");
-            return false;
-        }
-    }
-    lock_file(file, true);
     // Add a default name, national_id, account_type if not provided
-    fprintf(file, "%s %s %s %s %s %.2f\n", account_no, pin, "noname", "00000000", "savings", initial_balance);
-    fflush(file);
-    unlock_file(file);
-    fclose(file);
-    return true;
+    return insert_account(account_no, pin, "noname", "00000000", "savings", initial_balance);
 }
 
 // Utility Functions Implementation
@@ -439,18 +355,12 @@ static void generate_pin(char* pin_out) {
     sprintf(pin_out, "%04d", 1000 + rand() % 9000);
 }
 
-// Helper to generate a unique account number (incremental)
-static void generate_account_no(char* acct_out) {
-    FILE* file = fopen(DB_FILENAME, "r");
-    int max_acct = 100000; char line[MAX_LINE_LEN], acct[MAX_ACCT_LEN];
-    if (file) {
-        while (fgets(line, sizeof(line), file))
-            if (sscanf(line, "%s", acct) == 1) {
-                int n = atoi(acct); if (n > max_acct) max_acct = n;
-            }
-        fclose(file);
-    }
-    sprintf(acct_out, "%d", max_acct + 1);
+// Helper to generate a unique account number (leased from account.seq)
+static bool generate_account_no(char* acct_out) {
+    long next;
+    if (!acct_alloc_next(&next)) return false;
+    sprintf(acct_out, "%ld", next);
+    return true;
 }
 
 // Creates an account with minimum 1k, stores name, national ID, type, generates account number and PIN
@@ -461,199 +371,74 @@ bool open_account(const char* name, const char* national_id, const char* account
         printf("Invalid account type. Must be 'savings' or 'checking'.\n");
         return false;
     }
-    generate_account_no(out_account_no);
+    if (!generate_account_no(out_account_no)) return false;
     generate_pin(out_pin);
-    FILE* file = fopen(DB_FILENAME, "a+");
-    if (!file) {
-        perror("Error opening database file");
-        return false;
-    }
-    lock_file(file, true);
-    fprintf(file, "%s %s %s %s %s %.2f\n", out_account_no, out_pin, name, national_id, account_type, initial_deposit);
-    fflush(file);
-    unlock_file(file);
-    fclose(file);
-    return true;
+    return insert_account(out_account_no, out_pin, name, national_id, account_type, initial_deposit);
 }
 
 // Closes an account (marks as closed or removes from DB)
 bool close_account(const char* account_no, const char* pin) {
-    FILE* file = fopen(DB_FILENAME, "r");
-    if (!file) return false;
-    FILE* temp = fopen("temp.txt", "w");
-    if (!temp) {
-        fclose(file);
-        return false;
-    }
-    char line[MAX_LINE_LEN], file_acct[MAX_ACCT_LEN], file_pin[8];
-    bool closed = false;
-    lock_file(file, true);
-    lock_file(temp, true);
-    while (fgets(line, sizeof(line), file)) {
-        if (sscanf(line, "%s %s", file_acct, file_pin) == 2) {
-            if (strcmp(file_acct, account_no) == 0 && strcmp(file_pin, pin) == 0) {
-                closed = true;
-                continue;
-            }
-        }
-        fputs(line, temp);
-    }
-    unlock_file(file);
-    unlock_file(temp);
-    fclose(file);
-    fclose(temp);
-    remove(DB_FILENAME);
-    rename("temp.txt", DB_FILENAME);
-    char filename[64];
-    snprintf(filename, sizeof(filename), "%s.txt", account_no);
-    remove(filename);
-    return closed;
+    if (!shared_remove(account_no, pin)) return false;
+    txn_log_remove(account_no);
+    return true;
+}
+
+// A DEPOSIT or WITHDRAW waiting for shared_apply_delta to apply it
+typedef struct {
+    TxnOp op;
+    double amount;
+} PendingTxn;
+
+// shared_commit_fn: logs the change under the account's stripe, so two
+// children changing one account log in the order they applied. A change
+// whose flush later fails (SHARED_IO_ERROR) stands in memory, so it is
+// logged too.
+static void log_applied(const char* account_no, double balance, void* arg) {
+    const PendingTxn* txn = arg;
+    log_transaction(account_no, txn->op, txn->amount, balance);
 }
 
 // Withdraws, leaving at least 1k, in units of >= 500
 bool withdraw_extended(const char* account_no, const char* pin, double amount) {
     if (amount < 500) return false;
-    FILE* db = fopen(DB_FILENAME, "r+");
-    if (!db) return false;
-    char line[MAX_LINE_LEN], file_acct[MAX_ACCT_LEN], file_pin[8], name[64], national_id[32], account_type[16];
-    double balance = 0;
-    bool found = false;
-    while (fgets(line, sizeof(line), db)) {
-        if (sscanf(line, "%s %s %s %s %s %lf", file_acct, file_pin, name, national_id, account_type, &balance) == 6) {
-            if (strcmp(file_acct, account_no) == 0 && strcmp(file_pin, pin) == 0) {
-                found = true;
-                break;
-            }
-        }
-    }
-    fclose(db);
-    if (!found) return false;
-    if (balance - amount < 1000) return false;
-    if (!update_balance(account_no, balance - amount)) return false;
-    log_transaction(account_no, "WITHDRAW", amount, balance - amount);
-    return true;
+    double new_balance;
+    PendingTxn txn = { TXN_WITHDRAW, amount };
+    return shared_apply_delta(account_no, pin, -amount, 1000, &new_balance, log_applied, &txn) == SHARED_OK;
 }
 
 // Deposit at least 500
 bool deposit_extended(const char* account_no, const char* pin, double amount) {
     if (amount < 500) return false;
-    FILE* db = fopen(DB_FILENAME, "r");
-    if (!db) return false;
-    char line[MAX_LINE_LEN], file_acct[MAX_ACCT_LEN], file_pin[8], name[64], national_id[32], account_type[16];
-    double balance = 0;
-    bool found = false;
-    while (fgets(line, sizeof(line), db)) {
-        if (sscanf(line, "%s %s %s %s %s %lf", file_acct, file_pin, name, national_id, account_type, &balance) == 6) {
-            if (strcmp(file_acct, account_no) == 0 && strcmp(file_pin, pin) == 0) {
-                found = true;
-                break;
-            }
-        }
-    }
-    fclose(db);
-    if (!found) return false;
-    if (!update_balance(account_no, balance + amount)) return false;
-    log_transaction(account_no, "DEPOSIT", amount, balance + amount);
-    return true;
+    double new_balance;
+    PendingTxn txn = { TXN_DEPOSIT, amount };
+    return shared_apply_delta(account_no, pin, amount, -DBL_MAX, &new_balance, log_applied, &txn) == SHARED_OK;
 }
 
 // Returns the balance in the account
 bool balance(const char* account_no, double* out_balance) {
-    FILE* file = fopen(DB_FILENAME, "r");
-    if (!file) return false;
-    char line[MAX_LINE_LEN], file_acct[MAX_ACCT_LEN];
-    double file_balance;
-    bool found = false;
-    while (fgets(line, sizeof(line), file)) {
-        // Skip to the 6th field (balance)
-        if (sscanf(line, "%s %*s %*s %*s %*s %lf", file_acct, &file_balance) == 2) {
-            if (strcmp(file_acct, account_no) == 0) {
-                *out_balance = file_balance;
-                found = true;
-                break;
-            }
-        }
-    }
-    fclose(file);
-    return found;
+    return get_balance(account_no, out_balance);
 }
 
 // Returns last five transactions (debit/credit) for the account
 bool statement(const char* account_no, const char* pin, char transactions[5][MAX_LINE_LEN]) {
-    FILE *db = fopen(DB_FILENAME, "r");
-    if (!db) return false;
-    char line[MAX_LINE_LEN], file_acct[MAX_ACCT_LEN], file_pin[8];
-    bool found = false;
-    while (fgets(line, sizeof(line), db))
-        if (sscanf(line, "%s %s", file_acct, file_pin) == 2 &&
-            !strcmp(file_acct, account_no) && !strcmp(file_pin, pin)) { found = true; break; }
-    fclose(db);
-    if (!found) return false;
-    char filename[64]; snprintf(filename, sizeof(filename), "%s.txt", account_no);
-    FILE *tf = fopen(filename, "r"); if (!tf) return false;
-    char all[5][MAX_LINE_LEN] = {{0}}; int count = 0;
-    while (fgets(line, sizeof(line), tf))
-        count < 5 ? strncpy(all[count++], line, MAX_LINE_LEN) :
-        (memmove(all, all+1, 4*MAX_LINE_LEN), strncpy(all[4], line, MAX_LINE_LEN));
-    fclose(tf);
-    for (int i = 0; i < 5; ++i) strncpy(transactions[i], all[i], MAX_LINE_LEN);
+    if (!shared_check_pin(account_no, pin)) return false;
+    // Fixed-size records: the last five are one pread at the end of the log
+    TxnRecord records[5];
+    int count = txn_log_tail(account_no, 5, records);
+    for (int i = 0; i < count; ++i) {
+        char timebuf[TXN_TIME_LEN];
+        txn_format_time(records[i].timestamp, timebuf);
+        snprintf(transactions[i], MAX_LINE_LEN, "%s %.2f %.2f %s\n", txn_op_name(records[i].op),
+                 records[i].amount_cents / 100.0, records[i].balance_cents / 100.0, timebuf);
+    }
     return count > 0;
 }
 
-void log_transaction(const char* account_no, const char* type, double amount, double balance) {
-    char filename[64]; snprintf(filename, sizeof(filename), "%s.txt", account_no);
-    FILE* file = fopen(filename, "a"); if (!file) return;
-    time_t now = time(NULL); char timebuf[32];
-    strftime(timebuf, sizeof(timebuf), "%Y-%m-%d %H:%M:%S", localtime(&now));
-    fprintf(file, "%s %.2f %.2f %s\n", type, amount, balance, timebuf);
-    fclose(file);
+void log_transaction(const char* account_no, TxnOp op, double amount, double balance) {
+    txn_log_append(account_no, op, amount, balance, NULL);
 }
 // File I/O Functions Implementation
 
-// Cross-platform file locking function
-static void lock_file(FILE* file, bool exclusive) {
-#ifdef _WIN32
-    // Windows file locking
-    HANDLE hFile = (HANDLE)_get_osfhandle(_fileno(file));
-    OVERLAPPED overlapped = {0};
-    if (exclusive) {
-        LockFileEx(hFile, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped);
-    } else {
-        LockFileEx(hFile, 0, 0, MAXDWORD, MAXDWORD, &overlapped);
-    }
-#else
-    // Unix/Linux file locking
-    if (exclusive) {
-        flock(fileno(file), LOCK_EX);
-    } else {
-        flock(fileno(file), LOCK_SH);
-    }
-#endif
-}
-
-static void unlock_file(FILE* file) {
-#ifdef _WIN32
-    HANDLE hFile = (HANDLE)_get_osfhandle(_fileno(file));
-    OVERLAPPED overlapped = {0};
-    UnlockFileEx(hFile, 0, MAXDWORD, MAXDWORD, &overlapped);
-#else
-    flock(fileno(file), LOCK_UN);
-#endif
-}
-
 bool check_pin(const char* account_no, const char* pin) {
-    FILE* file = fopen(DB_FILENAME, "r");
-    if (!file) return false;
-    char line[MAX_LINE_LEN], file_acct[MAX_ACCT_LEN], file_pin[8];
-    bool found = false;
-    while (fgets(line, sizeof(line), file)) {
-        if (sscanf(line, "%s %s", file_acct, file_pin) == 2 &&
-            strcmp(file_acct, account_no) == 0 &&
-            strcmp(file_pin, pin) == 0) {
-            found = true;
-            break;
-        }
-    }
-    fclose(file);
-    return found;
-}
\ No newline at end of file
+    return shared_check_pin(account_no, pin);
+}
@@ -0,0 +1,645 @@
+#define _GNU_SOURCE // For MAP_ANONYMOUS, fdatasync, pthread_mutex_consistent
+#include "shared_accounts.h"
+#include "account_hash.h"
+#include <sched.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SLOT_EMPTY 0    // Zero so untouched pages of the mapping need no setup
+#define SLOT_DELETED -1 // Any other value is record number + 1
+#define LINE_LEN 256
+#define OPTIMISTIC_TRIES 64 // Lock-free lookups tried before taking index_lock
+
+// <db>.snap: SnapshotHeader, then record_count SharedAccounts, then the
+// verbatim lines. Only used when data.txt is still the file it was written
+// next to; otherwise the server falls back to parsing the text.
+#define SNAPSHOT_MAGIC "ACCTSNAP"
+#define SNAPSHOT_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;     // sizeof(SharedAccount)
+    uint64_t record_count;
+    uint64_t passthrough_len;
+    int64_t db_size;          // stat of data.txt right after it was renamed in
+    int64_t db_mtime_ns;
+    uint64_t db_ino;
+    uint32_t checksum;        // FNV-1a over everything after the header
+    uint32_t header_checksum; // FNV-1a over the fields above
+} SnapshotHeader;
+
+_Static_assert(sizeof(SnapshotHeader) == 64, "header size is part of the file format");
+
+// Head of the shared mapping; the slots, records and free list follow it
+typedef struct {
+    pthread_mutex_t index_lock;                   // Writers of slots, record counts, free list, account numbers
+    pthread_mutex_t stripes[SHARED_LOCK_STRIPES]; // Record contents
+    uint32_t index_seq;                           // Odd while index_lock's holder changes the slots
+
+    pthread_mutex_t flush_lock; // Guards everything below up to the index
+    pthread_cond_t flush_wanted;
+    pthread_cond_t flush_done;
+    uint64_t dirty_gen;         // Bumped after each change
+    uint64_t flushed_gen;       // Newest generation the writer has on disk
+    bool flush_failed;          // Last rewrite did not reach the disk
+
+    uint32_t capacity;     // Records the mapping has room for
+    uint32_t record_count; // Records ever used; removed ones wait in the free list
+    uint32_t free_count;
+    uint32_t tombstones;   // SLOT_DELETED slots, cleared by rebuild_index
+    long max_account_no;
+} SharedTable;
+
+// Set up by shared_open before any fork, so every process has them at the
+// same addresses
+static SharedTable* table = NULL;
+static int32_t* slots = NULL;         // hash_capacity entries, never more than half used
+static SharedAccount* records = NULL; // table->capacity entries
+static uint32_t* free_records = NULL; // Removed record numbers, reused by inserts first
+static size_t hash_capacity = 0;      // Power of two
+static char db_path[256];
+static char snap_path[sizeof(db_path) + 8];
+static char* passthrough = NULL; // Lines of the file that don't parse, kept verbatim
+static size_t passthrough_len = 0;
+
+static pthread_mutex_t* stripe_for(uint32_t hash) {
+    return &table->stripes[hash & (SHARED_LOCK_STRIPES - 1)];
+}
+
+// A child killed while holding a stripe leaves at most one balance store
+// behind it, which is either done or not, so the state is still consistent.
+// One killed holding index_lock is handled by lock_index.
+static void lock_mutex(pthread_mutex_t* m) {
+    if (pthread_mutex_lock(m) == EOWNERDEAD) pthread_mutex_consistent(m);
+}
+
+static int timedwait(pthread_cond_t* cond, pthread_mutex_t* m, const struct timespec* deadline) {
+    int rc = pthread_cond_timedwait(cond, m, deadline);
+    if (rc == EOWNERDEAD) {
+        pthread_mutex_consistent(m);
+        rc = 0;
+    }
+    return rc;
+}
+
+static struct timespec deadline_in(int seconds) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += seconds;
+    return ts;
+}
+
+static void init_locks(void) {
+    pthread_mutexattr_t ma;
+    pthread_mutexattr_init(&ma);
+    pthread_mutexattr_setpshared(&ma, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&ma, PTHREAD_MUTEX_ROBUST);
+    for (int i = 0; i < SHARED_LOCK_STRIPES; ++i) pthread_mutex_init(&table->stripes[i], &ma);
+    pthread_mutex_init(&table->flush_lock, &ma);
+    pthread_mutex_init(&table->index_lock, &ma);
+    pthread_mutexattr_destroy(&ma);
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setpshared(&ca, PTHREAD_PROCESS_SHARED);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&table->flush_wanted, &ca);
+    pthread_cond_init(&table->flush_done, &ca);
+    pthread_condattr_destroy(&ca);
+}
+
+// Returns the hash slot holding account_no, or -(free slot + 1) if absent.
+// Caller holds index_lock, or validates the result with index_seq.
+static long probe_hashed(const char* account_no, uint32_t hash) {
+    size_t mask = hash_capacity - 1;
+    size_t i = hash & mask;
+    long first_free = -1;
+
+    for (size_t n = 0; n < hash_capacity; ++n, i = (i + 1) & mask) {
+        int32_t s = __atomic_load_n(&slots[i], __ATOMIC_RELAXED);
+        if (s == SLOT_EMPTY) {
+            return -((first_free >= 0 ? first_free : (long)i) + 1);
+        }
+        if (s == SLOT_DELETED) {
+            if (first_free < 0) first_free = (long)i;
+            continue;
+        }
+        if (strncmp(records[s - 1].account_no, account_no, sizeof(records[0].account_no)) == 0) {
+            return (long)i;
+        }
+    }
+    // At most half the slots hold records and rebuild_index keeps tombstones
+    // under a quarter, so an empty slot always ends the loop before this
+    return -(first_free + 1);
+}
+
+// Caller holds index_lock (or is the only process, at load time)
+static bool insert_record(const SharedAccount* account) {
+    long pos = probe_hashed(account->account_no, hash_account_no(account->account_no));
+    if (pos >= 0) return false;
+    bool reuse = table->free_count > 0;
+    if (!reuse && table->record_count >= table->capacity) {
+        fprintf(stderr, "shared_accounts: table full (%u records)\n", table->capacity);
+        return false;
+    }
+    // The record is claimed only after the slot points at it
+    uint32_t r = reuse ? free_records[table->free_count - 1] : table->record_count;
+    records[r] = *account;
+    if (slots[-pos - 1] == SLOT_DELETED) table->tombstones--;
+    __atomic_store_n(&slots[-pos - 1], (int32_t)r + 1, __ATOMIC_RELAXED);
+    if (reuse) {
+        table->free_count--;
+    } else {
+        table->record_count++;
+    }
+
+    long n = atol(account->account_no);
+    if (n > table->max_account_no) table->max_account_no = n;
+    return true;
+}
+
+// Rehashes the live records into a cleared slot array, dropping every
+// tombstone. The mapping can't be resized, so this is done in place.
+// Caller holds index_lock.
+static void rebuild_index(void) {
+    for (size_t i = 0; i < hash_capacity; ++i) __atomic_store_n(&slots[i], SLOT_EMPTY, __ATOMIC_RELAXED);
+    table->tombstones = 0;
+    for (uint32_t r = 0; r < table->record_count; ++r) {
+        const char* account_no = records[r].account_no;
+        if (!account_no[0]) continue; // Removed, waiting in the free list
+        long pos = probe_hashed(account_no, hash_account_no(account_no));
+        __atomic_store_n(&slots[-pos - 1], (int32_t)r + 1, __ATOMIC_RELAXED);
+    }
+}
+
+// A process died holding index_lock, possibly halfway through an insert,
+// remove or rebuild. The records are the truth: the free list and the slots
+// are derived from them again, so an insert cut short is either kept whole
+// or forgotten, and a record is never both live and free.
+static void repair_index(void) {
+    table->free_count = 0;
+    for (uint32_t r = 0; r < table->record_count; ++r) {
+        if (!records[r].account_no[0]) free_records[table->free_count++] = r;
+    }
+    rebuild_index();
+    if (table->index_seq & 1) __atomic_store_n(&table->index_seq, table->index_seq + 1, __ATOMIC_RELEASE);
+}
+
+static void lock_index(void) {
+    if (pthread_mutex_lock(&table->index_lock) == EOWNERDEAD) {
+        pthread_mutex_consistent(&table->index_lock);
+        repair_index();
+    }
+}
+
+// Writers bracket every change to the slots or to a record's account number,
+// so lock-free lookups can tell they raced with one (a seqlock)
+static void begin_index_change(void) {
+    lock_index();
+    __atomic_store_n(&table->index_seq, table->index_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void end_index_change(void) {
+    __atomic_store_n(&table->index_seq, table->index_seq + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&table->index_lock);
+}
+
+// Finds account_no and locks its stripe. Returns the record number, or -1
+// (nothing locked) if the account does not exist. The record can't be
+// removed or reused until the caller unlocks the stripe, because
+// shared_remove clears it under that stripe.
+//
+// Lookups don't take index_lock, so they never wait for each other: the
+// probe runs unlocked and is retried if index_seq shows an insert or remove
+// overlapped it. Only a lookup that keeps losing to writers (or finds one
+// that died mid-change) falls back to the lock.
+static long lock_account(const char* account_no, uint32_t hash) {
+    pthread_mutex_t* stripe = stripe_for(hash);
+    for (int attempt = 0; attempt < OPTIMISTIC_TRIES; ++attempt) {
+        uint32_t seq = __atomic_load_n(&table->index_seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            sched_yield();
+            continue;
+        }
+        long pos = probe_hashed(account_no, hash);
+        int32_t s = pos >= 0 ? __atomic_load_n(&slots[pos], __ATOMIC_RELAXED) : SLOT_EMPTY;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&table->index_seq, __ATOMIC_RELAXED) != seq) continue;
+        if (s <= 0) return -1;
+
+        // A remove that has not bumped index_seq by now needs the stripe
+        // before it can clear the record
+        lock_mutex(stripe);
+        if (__atomic_load_n(&table->index_seq, __ATOMIC_ACQUIRE) == seq) return s - 1;
+        pthread_mutex_unlock(stripe);
+    }
+
+    long r = -1;
+    lock_index();
+    long pos = probe_hashed(account_no, hash);
+    if (pos >= 0) {
+        r = slots[pos] - 1;
+        lock_mutex(stripe);
+    }
+    pthread_mutex_unlock(&table->index_lock);
+    return r;
+}
+
+static void keep_verbatim(const char* line) {
+    size_t len = strlen(line);
+    char* grown = realloc(passthrough, passthrough_len + len + 1);
+    if (!grown) {
+        perror("shared_accounts: realloc failed");
+        return;
+    }
+    passthrough = grown;
+    memcpy(passthrough + passthrough_len, line, len + 1);
+    passthrough_len += len;
+}
+
+static void stat_identity(const struct stat* st, SnapshotHeader* h) {
+    h->db_size = (int64_t)st->st_size;
+    h->db_mtime_ns = (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+    h->db_ino = (uint64_t)st->st_ino;
+}
+
+static bool snapshot_usable(const SnapshotHeader* h, size_t file_len) {
+    SnapshotHeader expect;
+    struct stat st;
+    if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) != 0 || h->version != SNAPSHOT_VERSION ||
+        h->record_size != sizeof(SharedAccount) ||
+        h->header_checksum != fnv1a(FNV1A_INIT, h, offsetof(SnapshotHeader, header_checksum)) ||
+        file_len != sizeof(*h) + h->record_count * sizeof(SharedAccount) + h->passthrough_len) {
+        return false;
+    }
+    if (stat(db_path, &st) == -1) return false;
+    stat_identity(&st, &expect);
+    return h->db_size == expect.db_size && h->db_mtime_ns == expect.db_mtime_ns && h->db_ino == expect.db_ino;
+}
+
+// Reads and checks the snapshot header alone, so shared_open can size the
+// table without reading data.txt. The records are checked by load_snapshot.
+static bool snapshot_header(SnapshotHeader* out) {
+    int fd = open(snap_path, O_RDONLY);
+    if (fd == -1) return false;
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 && pread(fd, out, sizeof(*out), 0) == (ssize_t)sizeof(*out) &&
+              snapshot_usable(out, (size_t)st.st_size);
+    close(fd);
+    return ok;
+}
+
+// Fills the table from the snapshot: one mapping and a copy per record, no
+// parsing. Returns false, leaving the table empty, if the snapshot is
+// missing, damaged or older than data.txt.
+static bool load_snapshot(void) {
+    int fd = open(snap_path, O_RDONLY);
+    if (fd == -1) return false;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t len = (size_t)st.st_size;
+    const char* map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    const SnapshotHeader* h = (const SnapshotHeader*)map;
+    const SharedAccount* records = (const SharedAccount*)(map + sizeof(*h));
+    bool ok = snapshot_usable(h, len) && h->record_count <= table->capacity &&
+              h->checksum == fnv1a(FNV1A_INIT, map + sizeof(*h), len - sizeof(*h));
+    for (uint64_t r = 0; ok && r < h->record_count; ++r) ok = insert_record(&records[r]);
+    if (ok && h->passthrough_len) {
+        passthrough = malloc(h->passthrough_len + 1);
+        ok = passthrough != NULL;
+        if (ok) {
+            memcpy(passthrough, map + len - h->passthrough_len, h->passthrough_len);
+            passthrough[h->passthrough_len] = '\0';
+            passthrough_len = h->passthrough_len;
+        }
+    }
+    if (ok) {
+        printf("Loaded %u accounts from %s\n", table->record_count, snap_path);
+    } else {
+        fprintf(stderr, "shared_accounts: %s is stale or damaged, reading %s\n", snap_path, db_path);
+        table->record_count = 0;
+        table->max_account_no = 100000;
+        memset(slots, 0, hash_capacity * sizeof(*slots));
+    }
+    munmap((void*)map, len);
+    return ok;
+}
+
+// Written after every rewrite of data.txt; a failure here only costs the
+// next start its fast path
+static void write_snapshot(const SharedAccount* records, uint32_t count) {
+    SnapshotHeader h;
+    struct stat st;
+    memset(&h, 0, sizeof(h));
+    if (stat(db_path, &st) == -1) return;
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.version = SNAPSHOT_VERSION;
+    h.record_size = sizeof(SharedAccount);
+    h.record_count = count;
+    h.passthrough_len = passthrough_len;
+    stat_identity(&st, &h);
+    h.checksum = fnv1a(FNV1A_INIT, records, (size_t)count * sizeof(SharedAccount));
+    if (passthrough_len) h.checksum = fnv1a(h.checksum, passthrough, passthrough_len);
+    h.header_checksum = fnv1a(FNV1A_INIT, &h, offsetof(SnapshotHeader, header_checksum));
+
+    char temp_path[sizeof(snap_path) + 4];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", snap_path);
+    FILE* temp = fopen(temp_path, "wb");
+    bool ok = temp != NULL && fwrite(&h, sizeof(h), 1, temp) == 1 &&
+              fwrite(records, sizeof(SharedAccount), count, temp) == count &&
+              (passthrough_len == 0 || fwrite(passthrough, 1, passthrough_len, temp) == passthrough_len);
+    if (temp) {
+        ok = fflush(temp) == 0 && fdatasync(fileno(temp)) == 0 && ok;
+        ok = fclose(temp) == 0 && ok;
+    }
+    ok = ok && rename(temp_path, snap_path) == 0;
+    if (!ok) {
+        perror("shared_accounts: snapshot not written");
+        remove(temp_path);
+    }
+}
+
+static bool load(const char* db_filename) {
+    if (load_snapshot()) return true;
+
+    FILE* file = fopen(db_filename, "r");
+    if (!file) return errno == ENOENT; // No file yet, no accounts yet
+
+    char line[LINE_LEN];
+    SharedAccount a;
+    uint32_t skipped = 0;
+    while (fgets(line, sizeof(line), file)) {
+        memset(&a, 0, sizeof(a));
+        if (sscanf(line, "%15s %7s %63s %31s %15s %lf", a.account_no, a.pin, a.name,
+                   a.national_id, a.account_type, &a.balance) != 6 || !insert_record(&a)) {
+            // Malformed lines and duplicates are not served, but survive rewrites
+            keep_verbatim(line);
+            skipped++;
+        }
+    }
+    fclose(file);
+    printf("Loaded %u accounts from %s (%u lines kept as-is)\n", table->record_count, db_filename, skipped);
+    return true;
+}
+
+// Writes the live records to a temp file and renames it over the database
+static bool rewrite_file(void) {
+    lock_index();
+    uint32_t count = table->record_count;
+    SharedAccount* snapshot = malloc((count ? count : 1) * sizeof(SharedAccount));
+    uint32_t live = 0;
+    for (uint32_t r = 0; snapshot && r < count; ++r) {
+        const SharedAccount* rec = &records[r];
+        if (!rec->account_no[0]) continue; // Removed
+        pthread_mutex_t* stripe = stripe_for(hash_account_no(rec->account_no));
+        lock_mutex(stripe);
+        snapshot[live++] = *rec;
+        pthread_mutex_unlock(stripe);
+    }
+    pthread_mutex_unlock(&table->index_lock);
+    if (!snapshot) {
+        perror("shared_accounts: malloc failed");
+        return false;
+    }
+
+    char temp_path[sizeof(db_path) + 4];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", db_path);
+    FILE* temp = fopen(temp_path, "w");
+    bool ok = temp != NULL;
+    if (ok && passthrough_len) ok = fwrite(passthrough, 1, passthrough_len, temp) == passthrough_len;
+    for (uint32_t i = 0; ok && i < live; ++i) {
+        const SharedAccount* a = &snapshot[i];
+        ok = fprintf(temp, "%s %s %s %s %s %.2f\n", a->account_no, a->pin, a->name,
+                     a->national_id, a->account_type, a->balance) > 0;
+    }
+    if (temp) {
+        ok = fflush(temp) == 0 && fdatasync(fileno(temp)) == 0 && ok;
+        ok = fclose(temp) == 0 && ok;
+    }
+    ok = ok && rename(temp_path, db_path) == 0;
+    if (ok) {
+        write_snapshot(snapshot, live);
+    } else {
+        perror("shared_accounts: rewrite failed");
+    }
+    free(snapshot);
+    return ok;
+}
+
+// The persistence process: rewrites the file whenever children have made
+// changes since the last rewrite. Exits when the server does.
+static void writer_loop(pid_t server_pid) {
+    uint64_t written = 0;
+    for (;;) {
+        lock_mutex(&table->flush_lock);
+        while (table->dirty_gen == written) {
+            struct timespec deadline = deadline_in(1);
+            timedwait(&table->flush_wanted, &table->flush_lock, &deadline);
+            if (getppid() != server_pid) {
+                pthread_mutex_unlock(&table->flush_lock);
+                return;
+            }
+        }
+        uint64_t gen = table->dirty_gen;
+        pthread_mutex_unlock(&table->flush_lock);
+
+        // Every change counted in gen is already in the table
+        bool ok = rewrite_file();
+
+        lock_mutex(&table->flush_lock);
+        table->flushed_gen = gen;
+        table->flush_failed = !ok;
+        pthread_cond_broadcast(&table->flush_done);
+        pthread_mutex_unlock(&table->flush_lock);
+        written = gen;
+    }
+}
+
+// Called after a change is made in the table; returns once it is on disk
+static bool wait_for_flush(void) {
+    struct timespec deadline = deadline_in(SHARED_FLUSH_TIMEOUT);
+    lock_mutex(&table->flush_lock);
+    uint64_t gen = ++table->dirty_gen;
+    pthread_cond_signal(&table->flush_wanted);
+    int rc = 0;
+    while (table->flushed_gen < gen && rc != ETIMEDOUT) {
+        rc = timedwait(&table->flush_done, &table->flush_lock, &deadline);
+    }
+    bool ok = table->flushed_gen >= gen && !table->flush_failed;
+    pthread_mutex_unlock(&table->flush_lock);
+    if (!ok) fprintf(stderr, "shared_accounts: change not confirmed on disk\n");
+    return ok;
+}
+
+// Lines in the database, an upper bound on its accounts. 0 if it is missing.
+static size_t count_lines(const char* db_filename) {
+    FILE* file = fopen(db_filename, "r");
+    if (!file) return 0;
+    char chunk[65536];
+    size_t lines = 0, n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        for (const char* p = chunk; (p = memchr(p, '\n', (size_t)(chunk + n - p))) != NULL; ++p) lines++;
+    }
+    fclose(file);
+    return lines;
+}
+
+// Room for SHARED_TABLE_GROWTH times the accounts in the database, and at
+// least SHARED_TABLE_MIN_CAPACITY. The mapping can't grow once children
+// share it, but pages are only touched when used, so reserving is cheap.
+// The account count comes from the snapshot header when the snapshot
+// matches data.txt; only the text fallback reads the whole file for it.
+static uint32_t table_capacity(const char* db_filename) {
+    SnapshotHeader h;
+    size_t accounts = snapshot_header(&h) ? (size_t)h.record_count : count_lines(db_filename);
+    size_t wanted = accounts * SHARED_TABLE_GROWTH;
+    size_t capacity = SHARED_TABLE_MIN_CAPACITY;
+    while (capacity < wanted && capacity < ((size_t)1 << 30)) capacity *= 2;
+    return (uint32_t)capacity;
+}
+
+bool shared_open(const char* db_filename) {
+    snprintf(db_path, sizeof(db_path), "%s", db_filename);
+    snprintf(snap_path, sizeof(snap_path), "%s.snap", db_path);
+
+    uint32_t capacity = table_capacity(db_filename);
+    hash_capacity = (size_t)capacity * 2;
+    size_t header_len = (sizeof(SharedTable) + 63) & ~(size_t)63;
+    size_t slots_len = hash_capacity * sizeof(int32_t);
+    size_t records_len = (size_t)capacity * sizeof(SharedAccount);
+    size_t map_len = header_len + slots_len + records_len + (size_t)capacity * sizeof(uint32_t);
+    char* map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (map == MAP_FAILED) {
+        perror("shared_open: mmap failed");
+        return false;
+    }
+    table = (SharedTable*)map;
+    slots = (int32_t*)(map + header_len);
+    records = (SharedAccount*)(map + header_len + slots_len);
+    free_records = (uint32_t*)(map + header_len + slots_len + records_len);
+    table->capacity = capacity;
+    init_locks();
+    table->max_account_no = 100000;
+    if (!load(db_filename)) {
+        perror("shared_open: cannot read database");
+        return false;
+    }
+
+    pid_t server_pid = getpid();
+    fflush(stdout); // Or the writer inherits and repeats buffered output
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("shared_open: fork failed");
+        return false;
+    }
+    if (pid == 0) {
+        writer_loop(server_pid);
+        _exit(0);
+    }
+    return true;
+}
+
+long shared_max_account_no(void) {
+    lock_index();
+    long max_acct = table->max_account_no;
+    pthread_mutex_unlock(&table->index_lock);
+    return max_acct;
+}
+
+bool shared_get(const char* account_no, SharedAccount* out) {
+    uint32_t hash = hash_account_no(account_no);
+    long r = lock_account(account_no, hash);
+    if (r < 0) return false;
+    *out = records[r];
+    pthread_mutex_unlock(stripe_for(hash));
+    return true;
+}
+
+bool shared_check_pin(const char* account_no, const char* pin) {
+    SharedAccount a;
+    return shared_get(account_no, &a) && strncmp(a.pin, pin, sizeof(a.pin)) == 0;
+}
+
+SharedStatus shared_apply_delta(const char* account_no, const char* pin, double delta,
+                                double min_balance, double* out_balance,
+                                shared_commit_fn on_commit, void* arg) {
+    SharedStatus status = SHARED_NOT_FOUND;
+    uint32_t hash = hash_account_no(account_no);
+    long r = lock_account(account_no, hash);
+    if (r >= 0) {
+        SharedAccount* rec = &records[r];
+        if (!pin || strncmp(rec->pin, pin, sizeof(rec->pin)) == 0) {
+            double new_balance = rec->balance + delta;
+            if (new_balance < min_balance) {
+                status = SHARED_INSUFFICIENT_FUNDS;
+            } else {
+                rec->balance = new_balance;
+                status = SHARED_OK;
+                if (on_commit) on_commit(account_no, new_balance, arg);
+            }
+            *out_balance = rec->balance;
+        }
+        pthread_mutex_unlock(stripe_for(hash));
+    }
+
+    if (status == SHARED_OK && !wait_for_flush()) status = SHARED_IO_ERROR;
+    return status;
+}
+
+bool shared_set_balance(const char* account_no, double balance) {
+    uint32_t hash = hash_account_no(account_no);
+    long r = lock_account(account_no, hash);
+    if (r < 0) return false;
+    records[r].balance = balance;
+    pthread_mutex_unlock(stripe_for(hash));
+    return wait_for_flush();
+}
+
+bool shared_insert(const SharedAccount* account) {
+    begin_index_change();
+    bool inserted = insert_record(account);
+    end_index_change();
+    return inserted && wait_for_flush();
+}
+
+bool shared_remove(const char* account_no, const char* pin) {
+    bool removed = false;
+    uint32_t hash = hash_account_no(account_no);
+    begin_index_change();
+    long pos = probe_hashed(account_no, hash);
+    if (pos >= 0) {
+        SharedAccount* rec = &records[slots[pos] - 1];
+        // Cleared under its stripe, so a lookup holding the stripe keeps a valid record
+        lock_mutex(stripe_for(hash));
+        if (!pin || strncmp(rec->pin, pin, sizeof(rec->pin)) == 0) {
+            memset(rec, 0, sizeof(*rec));
+            removed = true;
+        }
+        pthread_mutex_unlock(stripe_for(hash));
+        if (removed) {
+            __atomic_store_n(&slots[pos], SLOT_DELETED, __ATOMIC_RELAXED);
+            free_records[table->free_count++] = (uint32_t)(rec - records);
+            // Misses probe past tombstones, so clear them before they pile up
+            if (++table->tombstones > hash_capacity / 4) rebuild_index();
+        }
+    }
+    end_index_change();
+    return removed && wait_for_flush();
+}
@@ -0,0 +1,86 @@
+#ifndef SHARED_ACCOUNTS_H
+#define SHARED_ACCOUNTS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Account table shared by every forked child.
+//
+// The parent loads data.txt once into an anonymous MAP_SHARED region before
+// it starts accepting, so children inherit the mapping and do lookups and
+// balance updates in place instead of re-reading the file. Record contents
+// are guarded by SHARED_LOCK_STRIPES process-shared mutexes picked by account
+// hash. Only inserts and removes take the index mutex; lookups probe the
+// index without it and retry if a sequence counter shows they overlapped a
+// change, so a balance read or update holds nothing but its account's stripe.
+// All mutexes are robust, so a child killed while holding one does not
+// deadlock the others. Lock order: index lock first, then one stripe.
+//
+// The table is sized when it is loaded, to SHARED_TABLE_GROWTH times the
+// accounts in the snapshot, or the lines in data.txt when there is no usable
+// snapshot (at least SHARED_TABLE_MIN_CAPACITY records). Records
+// freed by shared_remove are reused by the next insert; the hash slots they
+// leave as tombstones are cleared by rehashing in place once they fill a
+// quarter of the index.
+//
+// data.txt is only written by a single writer process. A mutation bumps a
+// generation counter and then waits until the writer has rewritten the file
+// with that generation included, so a reply still means the change is on
+// disk, but concurrent changes from many children share one rewrite.
+//
+// After each rewrite the writer also dumps the table to a checksummed binary
+// snapshot, <db>.snap. A restart copies the records straight out of it
+// instead of parsing data.txt, as long as data.txt has not changed since.
+#ifndef SHARED_TABLE_MIN_CAPACITY
+#define SHARED_TABLE_MIN_CAPACITY 65536 // Records reserved; pages are only touched when used
+#endif
+#define SHARED_TABLE_GROWTH 4           // Capacity per account at startup
+#define SHARED_LOCK_STRIPES 64      // Power of two
+#define SHARED_FLUSH_TIMEOUT 5      // Seconds a child waits for the writer
+
+typedef struct {
+    char account_no[16];
+    char pin[8];
+    char name[64];
+    char national_id[32];
+    char account_type[16];
+    double balance;
+} SharedAccount;
+
+// Result of a PIN-checked read-modify-write on one account
+typedef enum {
+    SHARED_OK,
+    SHARED_NOT_FOUND,       // Unknown account or wrong PIN
+    SHARED_INSUFFICIENT_FUNDS,
+    SHARED_IO_ERROR         // Applied in memory, but not confirmed on disk
+} SharedStatus;
+
+// Loads db_filename into the shared table and forks the writer process.
+// Call once in the parent, before the first client fork.
+bool shared_open(const char* db_filename);
+
+// Highest numeric account number in the table (100000 when empty)
+long shared_max_account_no(void);
+
+bool shared_get(const char* account_no, SharedAccount* out);
+bool shared_check_pin(const char* account_no, const char* pin);
+
+// Called by shared_apply_delta after a change, with the account's stripe
+// still held, so work done per change (such as logging it) happens in the
+// order the changes were applied
+typedef void (*shared_commit_fn)(const char* account_no, double balance, void* arg);
+
+// Adds delta to the balance of account_no if pin matches; a NULL pin skips the
+// check. A change that would leave the balance below min_balance is refused.
+// *out_balance receives the balance after the change (or the unchanged balance
+// when refused). on_commit (if not NULL) runs only for an applied change.
+SharedStatus shared_apply_delta(const char* account_no, const char* pin, double delta,
+                                double min_balance, double* out_balance,
+                                shared_commit_fn on_commit, void* arg);
+
+bool shared_set_balance(const char* account_no, double balance);
+bool shared_insert(const SharedAccount* account);
+// Removes account_no if pin matches; a NULL pin skips the check
+bool shared_remove(const char* account_no, const char* pin);
+
+#endif // SHARED_ACCOUNTS_H
@@ -0,0 +1,39 @@
+// txnconvert: one-shot conversion of text transaction logs to the binary
+// <account_no>.log format. Servers also convert a log lazily the first time
+// they open it; this tool does it up front for a whole directory.
+//   ./txnconvert 100001.txt 100002.txt ...
+#include "txn_log.h"
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <account_no>.txt...\n", argv[0]);
+        return 1;
+    }
+
+    int failures = 0;
+    for (int i = 1; i < argc; ++i) {
+        const char* txt = argv[i];
+        const char* base = strrchr(txt, '/') ? strrchr(txt, '/') + 1 : txt;
+        size_t digits = strspn(base, "0123456789");
+        if (digits == 0 || strcmp(base + digits, ".txt") != 0) {
+            fprintf(stderr, "Skipping %s: not an <account_no>.txt transaction log\n", txt);
+            continue;
+        }
+
+        char log[512];
+        snprintf(log, sizeof(log), "%.*s.log", (int)(strlen(txt) - 4), txt);
+        size_t records = 0;
+        if (txn_log_import_text(txt, log, &records)) {
+            remove(txt);
+            printf("%s -> %s (%zu records)\n", txt, log, records);
+        } else {
+            fprintf(stderr, "Failed to convert %s\n", txt);
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
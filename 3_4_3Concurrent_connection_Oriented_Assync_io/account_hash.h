@@ -0,0 +1,45 @@
+#ifndef ACCOUNT_HASH_H
+#define ACCOUNT_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// FNV-1a and the murmur3 finalizer, shared by the account index, the txn
+// ring, the log directory fan-out and the journal checksum. The log paths
+// and journal records on disk depend on these values: do not change them.
+
+#define FNV1A_INIT 2166136261u
+#define FNV1A_PRIME 16777619u
+
+// Continues an FNV-1a hash h over len bytes; start from FNV1A_INIT
+static inline uint32_t fnv1a(uint32_t h, const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= p[i];
+        h *= FNV1A_PRIME;
+    }
+    return h;
+}
+
+// FNV-1a over the account number digits
+static inline uint32_t hash_account_no(const char* account_no) {
+    uint32_t h = FNV1A_INIT;
+    for (const unsigned char* p = (const unsigned char*)account_no; *p; ++p) {
+        h ^= *p;
+        h *= FNV1A_PRIME;
+    }
+    return h;
+}
+
+// FNV alone leaves sequential account numbers poorly spread over the low
+// bytes; use this where those bits are taken directly rather than probed
+static inline uint32_t mix32(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+#endif // ACCOUNT_HASH_H
@@ -0,0 +1,343 @@
+#define _GNU_SOURCE // For fileno, mremap under -std=c11
+#include "account_index.h"
+#include "text_loader.h"
+#include "account_hash.h"
+#include <sys/file.h> // For flock
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SLOT_EMPTY   -1
+#define SLOT_DELETED -2
+#define INITIAL_CAPACITY 1024 // Hash slots and file slots, always a power of two
+
+static int db_fd = -1;
+static void* db_map = NULL;           // Whole accounts.db, MAP_SHARED
+static size_t db_map_len = 0;
+static AccountDbHeader* header = NULL;
+static AccountRecord* records = NULL; // Slot array right after the header
+
+static int32_t* slots = NULL;         // Open addressing table of slot numbers
+static size_t slot_capacity = 0;
+static size_t slot_used = 0;          // Live + deleted hash slots, drives resizing
+
+static long max_account_no = 100000;  // Same base as the old generate_account_no
+
+static size_t db_file_size(uint64_t slot_capacity_in_file) {
+    return sizeof(AccountDbHeader) + (size_t)slot_capacity_in_file * sizeof(AccountRecord);
+}
+
+static void set_map(void* map, size_t len) {
+    db_map = map;
+    db_map_len = len;
+    header = (AccountDbHeader*)map;
+    records = (AccountRecord*)((char*)map + sizeof(AccountDbHeader));
+}
+
+// Returns the slot holding account_no, or the first reusable slot for it
+// (negative return means "not found", encoded as -(slot + 1)).
+static long probe(const char* account_no) {
+    size_t mask = slot_capacity - 1;
+    size_t i = hash_account_no(account_no) & mask;
+    long first_free = -1;
+
+    for (size_t n = 0; n < slot_capacity; ++n, i = (i + 1) & mask) {
+        int32_t s = slots[i];
+        if (s == SLOT_EMPTY) {
+            return -((first_free >= 0 ? first_free : (long)i) + 1);
+        }
+        if (s == SLOT_DELETED) {
+            if (first_free < 0) first_free = (long)i;
+            continue;
+        }
+        if (strcmp(records[s].account_no, account_no) == 0) {
+            return (long)i;
+        }
+    }
+    return -(first_free + 1); // Table full of tombstones; first_free is always set here
+}
+
+static bool rehash(size_t new_capacity) {
+    int32_t* new_slots = malloc(new_capacity * sizeof(int32_t));
+    if (!new_slots) {
+        perror("index rehash: malloc failed");
+        return false;
+    }
+    for (size_t i = 0; i < new_capacity; ++i) new_slots[i] = SLOT_EMPTY;
+
+    free(slots);
+    slots = new_slots;
+    slot_capacity = new_capacity;
+    slot_used = 0;
+
+    for (size_t r = 0; r < header->slot_count; ++r) {
+        if (!records[r].in_use) continue;
+        long pos = probe(records[r].account_no);
+        slots[-pos - 1] = (int32_t)r;
+        slot_used++;
+    }
+    return true;
+}
+
+AccountRecord* index_find(const char* account_no) {
+    if (!slots || !account_no) return NULL;
+    long pos = probe(account_no);
+    return pos >= 0 ? &records[slots[pos]] : NULL;
+}
+
+// Doubles the slot area of the file and remaps it
+static bool grow_file(void) {
+    uint64_t new_capacity = header->slot_capacity * 2;
+    size_t new_len = db_file_size(new_capacity);
+
+    if (ftruncate(db_fd, (off_t)new_len) == -1) {
+        perror("index grow: ftruncate failed");
+        return false;
+    }
+    void* map = mremap(db_map, db_map_len, new_len, MREMAP_MAYMOVE);
+    if (map == MAP_FAILED) {
+        perror("index grow: mremap failed");
+        return false;
+    }
+    set_map(map, new_len);
+    header->slot_capacity = new_capacity;
+    return true;
+}
+
+AccountRecord* index_insert(const AccountRecord* record) {
+    if (!header) return NULL;
+
+    // Keep load (including tombstones) under 70%
+    if ((slot_used + 1) * 10 > slot_capacity * 7) {
+        if (!rehash(slot_capacity * 2)) return NULL;
+    }
+
+    long pos = probe(record->account_no);
+    if (pos >= 0) {
+        // Existing account: overwrite in place
+        AccountRecord* existing = &records[slots[pos]];
+        *existing = *record;
+        existing->in_use = 1;
+        return existing;
+    }
+
+    if (header->slot_count == header->slot_capacity && !grow_file()) {
+        return NULL;
+    }
+
+    size_t slot = (size_t)(-pos - 1);
+    if (slots[slot] == SLOT_EMPTY) slot_used++;
+    slots[slot] = (int32_t)header->slot_count;
+
+    // Fill the slot before publishing it through slot_count
+    AccountRecord* added = &records[header->slot_count];
+    *added = *record;
+    added->in_use = 1;
+    header->slot_count++;
+
+    long acct_val = atol(added->account_no);
+    if (acct_val > max_account_no) max_account_no = acct_val;
+    return added;
+}
+
+bool index_remove(const char* account_no) {
+    if (!slots || !account_no) return false;
+    long pos = probe(account_no);
+    if (pos < 0) return false;
+    records[slots[pos]].in_use = 0;
+    slots[pos] = SLOT_DELETED; // Still counted in slot_used until the next rehash
+    return true;
+}
+
+long index_max_account_no(void) {
+    return max_account_no;
+}
+
+static bool check_header(const char* db_filename, size_t file_len) {
+    if (file_len < sizeof(AccountDbHeader) || memcmp(header->magic, ACCOUNT_DB_MAGIC, 8) != 0) {
+        fprintf(stderr, "%s is not an account database\n", db_filename);
+        return false;
+    }
+    if ((header->version != ACCOUNT_DB_VERSION && header->version != 1) ||
+        header->slot_size != sizeof(AccountRecord)) {
+        fprintf(stderr, "%s: unsupported version %u / slot size %u\n", db_filename,
+                header->version, header->slot_size);
+        return false;
+    }
+    if (header->slot_count > header->slot_capacity || file_len < db_file_size(header->slot_capacity)) {
+        fprintf(stderr, "%s is truncated (%llu slots, %zu bytes)\n", db_filename,
+                (unsigned long long)header->slot_capacity, file_len);
+        return false;
+    }
+    return true;
+}
+
+// Rewrites version 1 double balances as cents. No realistic cents value is
+// 2^52 or more, while any nonzero double's bit pattern is, so slots already
+// converted by an interrupted upgrade are left alone and a rerun is safe.
+static bool upgrade_v1(const char* db_filename) {
+    const int64_t double_bits = (int64_t)1 << 52;
+    for (uint64_t r = 0; r < header->slot_count; ++r) {
+        int64_t bits = records[r].balance_cents;
+        if (bits < double_bits && bits > -double_bits) continue;
+        double legacy;
+        memcpy(&legacy, &bits, sizeof(legacy));
+        records[r].balance_cents = money_from_double(legacy);
+    }
+    // Slots reach the disk before the header claims the new version
+    if (msync(db_map, db_map_len, MS_SYNC) == -1) {
+        perror("index_open: msync failed during upgrade");
+        return false;
+    }
+    header->version = ACCOUNT_DB_VERSION;
+    if (msync(db_map, db_map_len, MS_SYNC) == -1) {
+        perror("index_open: msync failed during upgrade");
+        return false;
+    }
+    printf("Upgraded %s to cents (version %d)\n", db_filename, ACCOUNT_DB_VERSION);
+    return true;
+}
+
+bool index_open(const char* db_filename, bool* out_created) {
+    index_close();
+
+    db_fd = open(db_filename, O_RDWR | O_CREAT, 0644);
+    if (db_fd == -1) {
+        perror("index_open: open failed");
+        return false;
+    }
+    // Two servers mapping the same file would overwrite each other's slots
+    if (flock(db_fd, LOCK_EX | LOCK_NB) == -1) {
+        perror("index_open: accounts file is in use");
+        index_close();
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(db_fd, &st) == -1) {
+        perror("index_open: fstat failed");
+        index_close();
+        return false;
+    }
+
+    bool created = st.st_size == 0;
+    size_t len = created ? db_file_size(INITIAL_CAPACITY) : (size_t)st.st_size;
+    if (created && ftruncate(db_fd, (off_t)len) == -1) {
+        perror("index_open: ftruncate failed");
+        index_close();
+        return false;
+    }
+
+    void* map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, db_fd, 0);
+    if (map == MAP_FAILED) {
+        perror("index_open: mmap failed");
+        index_close();
+        return false;
+    }
+    set_map(map, len);
+
+    if (created) {
+        memcpy(header->magic, ACCOUNT_DB_MAGIC, 8);
+        header->version = ACCOUNT_DB_VERSION;
+        header->slot_size = sizeof(AccountRecord);
+        header->slot_count = 0;
+        header->slot_capacity = INITIAL_CAPACITY;
+    } else if (!check_header(db_filename, len) || (header->version == 1 && !upgrade_v1(db_filename))) {
+        index_close();
+        return false;
+    }
+
+    // Size the hash table for the live slots at < 70% load
+    size_t live = 0;
+    for (uint64_t r = 0; r < header->slot_count; ++r) {
+        if (!records[r].in_use) continue;
+        live++;
+        long acct_val = atol(records[r].account_no);
+        if (acct_val > max_account_no) max_account_no = acct_val;
+    }
+    size_t capacity = INITIAL_CAPACITY;
+    while (live * 10 >= capacity * 7) capacity *= 2;
+    if (!rehash(capacity)) {
+        index_close();
+        return false;
+    }
+
+    if (out_created) *out_created = created;
+    printf("Opened %s: %zu live accounts in %llu slots\n", db_filename, live,
+           (unsigned long long)header->slot_count);
+    return true;
+}
+
+bool index_sync(void) {
+    if (!db_map) return false;
+    if (msync(db_map, db_map_len, MS_SYNC) == -1) {
+        perror("index_sync: msync failed");
+        return false;
+    }
+    return true;
+}
+
+static bool import_record(const AccountRecord* rec, void* arg) {
+    (void)arg;
+    return index_insert(rec) != NULL;
+}
+
+bool index_import_text(const char* txt_filename, size_t* out_imported) {
+    // Parsed on every core, inserted here in file order
+    return text_load_parallel(txt_filename, 0, import_record, NULL, out_imported);
+}
+
+bool index_export_text(const char* txt_filename) {
+    if (!header) return false;
+
+    char temp_filename[64];
+    snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", txt_filename);
+
+    FILE* temp_file = fopen(temp_filename, "w");
+    if (!temp_file) {
+        perror("index_export_text: temp file create error");
+        return false;
+    }
+
+    flock(fileno(temp_file), LOCK_EX);
+    char balance[MONEY_STR_LEN];
+    for (uint64_t r = 0; r < header->slot_count; ++r) {
+        const AccountRecord* rec = &records[r];
+        if (!rec->in_use) continue;
+        money_format(balance, rec->balance_cents);
+        fprintf(temp_file, "%s %s %s %s %s %s\n", rec->account_no, rec->pin, rec->name,
+                rec->national_id, rec->account_type, balance);
+    }
+    fflush(temp_file);
+    if (fsync(fileno(temp_file)) == -1) perror("index_export_text: fsync failed");
+    flock(fileno(temp_file), LOCK_UN);
+
+    if (ferror(temp_file)) {
+        fprintf(stderr, "index_export_text: write error on %s\n", temp_filename);
+        fclose(temp_file);
+        remove(temp_filename);
+        return false;
+    }
+    fclose(temp_file);
+
+    // rename() replaces the old file atomically, readers see either version
+    if (rename(temp_filename, txt_filename) != 0) {
+        perror("index_export_text: rename failed");
+        remove(temp_filename);
+        return false;
+    }
+    return true;
+}
+
+void index_close(void) {
+    if (db_map) munmap(db_map, db_map_len);
+    if (db_fd != -1) close(db_fd); // Also releases the flock
+    free(slots);
+    db_fd = -1;
+    db_map = NULL;
+    db_map_len = 0;
+    header = NULL;
+    records = NULL;
+    slots = NULL;
+    slot_capacity = slot_used = 0;
+    max_account_no = 100000;
+}
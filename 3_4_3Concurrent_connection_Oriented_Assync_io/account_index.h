@@ -0,0 +1,70 @@
+#ifndef ACCOUNT_INDEX_H
+#define ACCOUNT_INDEX_H
+
+#include "common.h"
+#include "money.h"
+#include <stdint.h>
+
+// accounts.db layout (native byte order):
+//   [AccountDbHeader, 64 bytes][AccountRecord slot 0][slot 1]...
+// Every slot is ACCOUNT_SLOT_SIZE bytes, a multiple of the cache line, so a
+// balance update is a single store into one mapped slot. Slots are never
+// moved; a closed account just clears in_use.
+//
+// Version 1 stored the balance as a double; index_open converts such a file
+// to cents in place.
+#define ACCOUNT_DB_MAGIC "ACCTDB\0\0"
+#define ACCOUNT_DB_VERSION 2
+#define ACCOUNT_SLOT_SIZE 192
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_size;     // Must equal ACCOUNT_SLOT_SIZE
+    uint64_t slot_count;    // Slots handed out so far (live + closed)
+    uint64_t slot_capacity; // Slots the file currently has room for
+    char reserved[32];
+} AccountDbHeader;
+
+// One account slot. Hot fields (lookup key, PIN, balance) share the first
+// cache line; the descriptive fields follow.
+typedef struct {
+    char account_no[MAX_ACCT_LEN + 2];
+    char pin[10];
+    uint8_t in_use; // 0 once the account has been closed
+    uint8_t reserved;
+    money_t balance_cents;
+    char name[64];
+    char national_id[32];
+    char account_type[16];
+    char padding[48];
+} AccountRecord;
+
+_Static_assert(sizeof(AccountDbHeader) == 64, "header must stay one cache line");
+_Static_assert(sizeof(AccountRecord) == ACCOUNT_SLOT_SIZE, "slot size is part of the file format");
+
+// Opens (or creates) the slot file and maps it. The hash index from account
+// number to slot is rebuilt from the live slots. *out_created is set when the
+// file did not exist yet, so the caller can import a legacy data.txt.
+bool index_open(const char* db_filename, bool* out_created);
+void index_close(void);
+
+// Returns the live record for account_no, or NULL. The pointer refers to the
+// mapped slot and stays valid until the next index_insert (the mapping may
+// move when the file grows).
+AccountRecord* index_find(const char* account_no);
+AccountRecord* index_insert(const AccountRecord* record);
+bool index_remove(const char* account_no);
+
+// Highest account number ever inserted (100000 when the index is empty).
+long index_max_account_no(void);
+
+// Flushes dirty slots and the header to disk (msync).
+bool index_sync(void);
+
+// Converters between accounts.db and the legacy text format
+// "%s %s %s %s %s %.2f" (account, pin, name, national id, type, balance).
+bool index_import_text(const char* txt_filename, size_t* out_imported);
+bool index_export_text(const char* txt_filename);
+
+#endif // ACCOUNT_INDEX_H
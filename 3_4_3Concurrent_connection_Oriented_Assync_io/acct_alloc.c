@@ -0,0 +1,71 @@
+#define _GNU_SOURCE // For pread/pwrite, fdatasync, flock
+#include "acct_alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/file.h>
+
+#define SEQ_RECORD_LEN 21 // "%020ld\n", fixed width so it is rewritten in place
+
+static char seq_path[256];
+static long seq_floor = 0;
+static long lease_size = ACCT_LEASE_SIZE;
+
+static pthread_mutex_t lease_lock = PTHREAD_MUTEX_INITIALIZER;
+static long lease_next = 0; // [lease_next, lease_end) still unused
+static long lease_end = 0;
+static pid_t lease_pid = 0; // Process the lease belongs to
+
+// Takes [start, start + count) from the counter file and advances it
+static bool lease_block(long count, long* out_start) {
+    int fd = open(seq_path, O_RDWR | O_CREAT, 0644);
+    if (fd == -1) {
+        perror("acct_alloc: open failed");
+        return false;
+    }
+    flock(fd, LOCK_EX);
+
+    char buf[SEQ_RECORD_LEN + 1] = {0};
+    ssize_t n = pread(fd, buf, SEQ_RECORD_LEN, 0);
+    long next = n > 0 ? atol(buf) : 0;
+    if (next < seq_floor) next = seq_floor;
+
+    snprintf(buf, sizeof(buf), "%020ld\n", next + count);
+    // Durable before any number from the block is handed out
+    bool ok = pwrite(fd, buf, SEQ_RECORD_LEN, 0) == SEQ_RECORD_LEN && fdatasync(fd) == 0;
+    if (!ok) perror("acct_alloc: counter update failed");
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    if (ok) *out_start = next;
+    return ok;
+}
+
+bool acct_alloc_init(const char* seq_filename, long floor, long block) {
+    snprintf(seq_path, sizeof(seq_path), "%s", seq_filename);
+    seq_floor = floor;
+    lease_size = block > 0 ? block : 1;
+    long unused;
+    return lease_block(0, &unused); // Creates/bumps the file without using numbers
+}
+
+bool acct_alloc_next(long* out) {
+    bool ok = true;
+    pid_t pid = getpid();
+
+    pthread_mutex_lock(&lease_lock);
+    if (lease_pid != pid || lease_next >= lease_end) {
+        long start;
+        ok = lease_block(lease_size, &start);
+        if (ok) {
+            lease_next = start;
+            lease_end = start + lease_size;
+            lease_pid = pid;
+        }
+    }
+    if (ok) *out = lease_next++;
+    pthread_mutex_unlock(&lease_lock);
+    return ok;
+}
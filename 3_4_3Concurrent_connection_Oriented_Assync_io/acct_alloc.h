@@ -0,0 +1,28 @@
+#ifndef ACCT_ALLOC_H
+#define ACCT_ALLOC_H
+
+#include <stdbool.h>
+
+// Persistent account-number allocator.
+//
+// The next unleased number lives in a small counter file. A process takes a
+// block of numbers from it under flock and then hands them out from memory,
+// so opening an account never scans the account store and concurrent
+// openers (threads, or forked processes sharing the file) never receive the
+// same number. Numbers left in a lease when a process exits are skipped, not
+// reused.
+#define ACCT_SEQ_FILENAME "account.seq"
+#define ACCT_LEASE_SIZE 64
+
+// floor is the smallest number that may be handed out, e.g. one past the
+// highest account already on disk; the counter file is created or bumped up
+// to it if needed. lease_size is how many numbers one flock round trip
+// reserves: use ACCT_LEASE_SIZE for long-lived servers, 1 when every process
+// opens at most one account before exiting. Call once at startup.
+bool acct_alloc_init(const char* seq_filename, long floor, long lease_size);
+
+// Returns the next account number. Thread-safe; a lease inherited through
+// fork() is dropped so parent and child never share numbers.
+bool acct_alloc_next(long* out);
+
+#endif // ACCT_ALLOC_H
@@ -0,0 +1,51 @@
+// dbconvert - converts between the legacy data.txt format and accounts.db
+//
+//   ./dbconvert import data.txt accounts.db   (accounts.db must not exist yet)
+//   ./dbconvert export accounts.db data.txt
+//
+// Stop the server first: it holds an exclusive lock on accounts.db.
+#include "account_index.h"
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s import <data.txt> <accounts.db>\n", prog);
+    fprintf(stderr, "       %s export <accounts.db> <data.txt>\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 4) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], "import") == 0) {
+        bool created = false;
+        if (!index_open(argv[3], &created)) return EXIT_FAILURE;
+        if (!created) {
+            fprintf(stderr, "%s already exists, refusing to merge into it\n", argv[3]);
+            index_close();
+            return EXIT_FAILURE;
+        }
+        size_t imported = 0;
+        bool ok = index_import_text(argv[2], &imported) && index_sync();
+        index_close();
+        if (!ok) {
+            remove(argv[3]);
+            return EXIT_FAILURE;
+        }
+        printf("Imported %zu accounts into %s\n", imported, argv[3]);
+    } else if (strcmp(argv[1], "export") == 0) {
+        if (access(argv[2], F_OK) != 0) {
+            perror(argv[2]);
+            return EXIT_FAILURE;
+        }
+        if (!index_open(argv[2], NULL)) return EXIT_FAILURE;
+        bool ok = index_export_text(argv[3]);
+        index_close();
+        if (!ok) return EXIT_FAILURE;
+        printf("Exported %s to %s\n", argv[2], argv[3]);
+    } else {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+#define _GNU_SOURCE // For ftruncate under -std=c11
+#include "journal.h"
+#include "account_hash.h"
+#include <stdint.h>
+#include <stddef.h>
+
+// Records written before balances were kept in cents held a double in the
+// balance field and zero padding where format now is.
+#define JOURNAL_FORMAT_CENTS 1
+
+typedef struct {
+    char account_no[MAX_ACCT_LEN + 2]; // NUL padded
+    uint32_t format;                   // JOURNAL_FORMAT_CENTS, or 0 for a legacy double
+    int64_t balance_cents;
+    uint32_t seq;                      // Increments per record, resets at checkpoint
+    uint32_t checksum;                 // FNV-1a over everything above
+} JournalRecord;
+
+_Static_assert(sizeof(JournalRecord) == 32, "record size is part of the file format");
+
+static int journal_fd = -1;
+static size_t pending = 0;
+static bool unsynced = false; // Records appended since the last journal_sync
+
+static uint32_t record_checksum(const JournalRecord* rec) {
+    return fnv1a(FNV1A_INIT, rec, offsetof(JournalRecord, checksum));
+}
+
+bool journal_replay(const char* filename, journal_apply_fn apply, size_t* out_applied) {
+    size_t applied = 0;
+    if (out_applied) *out_applied = 0;
+
+    int fd = open(filename, O_RDWR);
+    if (fd == -1) {
+        if (errno == ENOENT) return true; // Nothing written since the last checkpoint
+        perror("journal_replay: open failed");
+        return false;
+    }
+
+    JournalRecord rec;
+    off_t good_end = 0;
+    ssize_t n;
+    while ((n = read(fd, &rec, sizeof(rec))) == (ssize_t)sizeof(rec)) {
+        if (rec.checksum != record_checksum(&rec) || rec.seq != applied) break;
+        rec.account_no[sizeof(rec.account_no) - 1] = '\0';
+        money_t balance = rec.balance_cents;
+        if (rec.format != JOURNAL_FORMAT_CENTS) {
+            double legacy;
+            memcpy(&legacy, &rec.balance_cents, sizeof(legacy));
+            balance = money_from_double(legacy);
+        }
+        if (!apply(rec.account_no, balance)) {
+            fprintf(stderr, "journal_replay: skipping record for unknown account %s\n", rec.account_no);
+        }
+        applied++;
+        good_end += sizeof(rec);
+    }
+
+    off_t file_end = lseek(fd, 0, SEEK_END);
+    if (file_end > good_end) {
+        fprintf(stderr, "journal_replay: discarding %lld bytes of torn journal tail\n",
+                (long long)(file_end - good_end));
+        if (ftruncate(fd, good_end) == -1) perror("journal_replay: ftruncate failed");
+    }
+    close(fd);
+
+    pending = applied;
+    if (out_applied) *out_applied = applied;
+    return true;
+}
+
+bool journal_open(const char* filename) {
+    journal_fd = open(filename, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (journal_fd == -1) {
+        perror("journal_open: open failed");
+        return false;
+    }
+    return true;
+}
+
+bool journal_append(const char* account_no, money_t balance) {
+    if (journal_fd == -1) return false;
+
+    JournalRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    strncpy(rec.account_no, account_no, sizeof(rec.account_no) - 1);
+    rec.format = JOURNAL_FORMAT_CENTS;
+    rec.balance_cents = balance;
+    rec.seq = (uint32_t)pending;
+    rec.checksum = record_checksum(&rec);
+
+    // A single write() of one record; O_APPEND keeps records contiguous
+    if (write(journal_fd, &rec, sizeof(rec)) != (ssize_t)sizeof(rec)) {
+        perror("journal_append: write failed");
+        return false;
+    }
+    pending++;
+    unsynced = true;
+    return true;
+}
+
+bool journal_sync(void) {
+    if (!unsynced) return true;
+    if (journal_fd == -1) return false;
+    if (fdatasync(journal_fd) == -1) {
+        perror("journal_sync: fdatasync failed");
+        return false;
+    }
+    unsynced = false;
+    return true;
+}
+
+bool journal_reset(void) {
+    if (journal_fd == -1) return false;
+    if (ftruncate(journal_fd, 0) == -1) {
+        perror("journal_reset: ftruncate failed");
+        return false;
+    }
+    pending = 0;
+    return true;
+}
+
+size_t journal_pending(void) {
+    return pending;
+}
+
+void journal_close(void) {
+    if (journal_fd != -1) close(journal_fd);
+    journal_fd = -1;
+}
@@ -0,0 +1,30 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "common.h"
+#include "money.h"
+
+// Append-only balance journal. Every balance change is one fixed-size record
+// holding the account's new absolute balance, so replaying a record twice is
+// harmless. accounts.db is only msynced at checkpoints, after which the
+// journal is truncated. Appended records survive a crash of the machine only
+// once journal_sync has returned true.
+
+// Callback used by journal_replay for each valid record, in write order.
+typedef bool (*journal_apply_fn)(const char* account_no, money_t balance);
+
+// Replays filename on top of the already-loaded checkpoint. Stops at the first
+// torn or corrupt record and cuts the file back to the last good one.
+bool journal_replay(const char* filename, journal_apply_fn apply, size_t* out_applied);
+
+bool journal_open(const char* filename);
+bool journal_append(const char* account_no, money_t balance);
+// fdatasyncs the records appended since the last sync, if any. Callers batch
+// appends and sync once before acknowledging any of them.
+bool journal_sync(void);
+// Drops all records; call only after the checkpoint has reached disk.
+bool journal_reset(void);
+size_t journal_pending(void); // Records written since the last reset
+void journal_close(void);
+
+#endif // JOURNAL_H
@@ -0,0 +1,89 @@
+// loadbench - lines/second of text_load_parallel against the fgets+sscanf
+// loop index_import_text used before it
+//
+//   ./loadbench -g 5000000 big.txt   (writes a synthetic data.txt)
+//   ./loadbench big.txt [threads]    (threads defaults to one per CPU)
+//
+// Both loaders parse into AccountRecords and hand them to a sink that only
+// counts, so the figures are parsing cost alone, without index inserts.
+#define _GNU_SOURCE // For clock_gettime under -std=c11
+#include "text_loader.h"
+
+#define ROUNDS 3 // Best of
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static bool count_record(const AccountRecord* rec, void* arg) {
+    size_t* seen = arg;
+    *seen += rec->account_no[0] != '\0'; // Touch the record so it isn't optimized away
+    return true;
+}
+
+// The loop index_import_text ran before text_loader
+static size_t load_sequential(const char* filename) {
+    FILE* file = fopen(filename, "r");
+    if (!file) return 0;
+    char line[MAX_LINE_LEN];
+    AccountRecord rec;
+    double balance;
+    size_t seen = 0;
+    while (fgets(line, sizeof(line), file)) {
+        memset(&rec, 0, sizeof(rec));
+        if (sscanf(line, "%10s %9s %63s %31s %15s %lf", rec.account_no, rec.pin, rec.name,
+                   rec.national_id, rec.account_type, &balance) != 6) {
+            continue;
+        }
+        rec.balance_cents = money_from_double(balance);
+        count_record(&rec, &seen);
+    }
+    fclose(file);
+    return seen;
+}
+
+static int generate(const char* filename, long lines) {
+    FILE* out = fopen(filename, "w");
+    if (!out) {
+        perror(filename);
+        return EXIT_FAILURE;
+    }
+    srand(1);
+    for (long i = 0; i < lines; ++i) {
+        fprintf(out, "%ld %04d Holder%ld %08ld %s %d.%02d\n", 100001 + i, 1000 + rand() % 9000, i,
+                (long)rand() % 100000000, i % 3 ? "savings" : "checking", rand() % 1000000, rand() % 100);
+    }
+    fclose(out);
+    printf("Wrote %ld lines to %s\n", lines, filename);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 4 && strcmp(argv[1], "-g") == 0) return generate(argv[3], atol(argv[2]));
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s <data.txt> [threads]\n       %s -g <lines> <data.txt>\n", argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+    int threads = argc == 3 ? atoi(argv[2]) : 0;
+
+    double best_seq = 0, best_par = 0;
+    size_t seq_count = 0, par_count = 0;
+    for (int round = 0; round < ROUNDS; ++round) {
+        double t0 = now_sec();
+        seq_count = load_sequential(argv[1]);
+        double t1 = now_sec();
+        size_t seen = 0;
+        if (!text_load_parallel(argv[1], threads, count_record, &seen, &par_count)) return EXIT_FAILURE;
+        double t2 = now_sec();
+        if (round == 0 || t1 - t0 < best_seq) best_seq = t1 - t0;
+        if (round == 0 || t2 - t1 < best_par) best_par = t2 - t1;
+    }
+
+    printf("fgets+sscanf:       %zu records in %.3f s, %.0f lines/s\n", seq_count, best_seq, seq_count / best_seq);
+    printf("text_load_parallel: %zu records in %.3f s, %.0f lines/s (%ld threads)\n", par_count, best_par,
+           par_count / best_par, threads > 0 ? (long)threads : sysconf(_SC_NPROCESSORS_ONLN));
+    if (seq_count != par_count) fprintf(stderr, "Record counts differ\n");
+    return seq_count == par_count ? EXIT_SUCCESS : EXIT_FAILURE;
+}
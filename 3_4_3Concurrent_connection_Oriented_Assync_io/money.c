@@ -0,0 +1,78 @@
+#include "money.h"
+#include <string.h>
+
+// Largest whole part that still leaves room for .99 in an int64_t
+#define MAX_WHOLE (((uint64_t)INT64_MAX - 99) / 100)
+
+bool money_parse_n(const char* s, size_t len, money_t* out) {
+    const char* end = s + len;
+    bool negative = s < end && *s == '-';
+    if (negative) s++;
+
+    uint64_t whole = 0;
+    int digits = 0;
+    for (; s < end && *s >= '0' && *s <= '9'; ++s, ++digits) {
+        whole = whole * 10 + (uint64_t)(*s - '0');
+        if (whole > MAX_WHOLE) return false;
+    }
+
+    uint64_t cents = 0;
+    int decimals = 0;
+    if (s < end && *s == '.') {
+        for (++s; s < end && *s >= '0' && *s <= '9'; ++s, ++decimals) {
+            if (decimals == 2) return false; // Sub-cent amounts are rejected, not rounded
+            cents = cents * 10 + (uint64_t)(*s - '0');
+        }
+        if (decimals == 1) cents *= 10;
+    }
+    if (s != end || digits + decimals == 0) return false;
+
+    money_t value = (money_t)(whole * 100 + cents);
+    *out = negative ? -value : value;
+    return true;
+}
+
+bool money_parse(const char* s, money_t* out) {
+    return s && money_parse_n(s, strlen(s), out);
+}
+
+size_t money_format(char* out, money_t cents) {
+    uint64_t v = cents < 0 ? (uint64_t)0 - (uint64_t)cents : (uint64_t)cents;
+    char digits[MONEY_STR_LEN];
+    char* p = digits + sizeof(digits);
+
+    // Built backwards from the last cent digit
+    *--p = (char)('0' + v % 10);
+    v /= 10;
+    *--p = (char)('0' + v % 10);
+    v /= 10;
+    *--p = '.';
+    do {
+        *--p = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    if (cents < 0) *--p = '-';
+
+    size_t len = (size_t)(digits + sizeof(digits) - p);
+    memcpy(out, p, len);
+    out[len] = '\0';
+    return len;
+}
+
+bool money_add(money_t a, money_t b, money_t* out) {
+    money_t sum;
+    if (__builtin_add_overflow(a, b, &sum)) return false;
+    *out = sum;
+    return true;
+}
+
+bool money_sub(money_t a, money_t b, money_t* out) {
+    money_t difference;
+    if (__builtin_sub_overflow(a, b, &difference)) return false;
+    *out = difference;
+    return true;
+}
+
+money_t money_from_double(double amount) {
+    return (money_t)(amount * 100.0 + (amount < 0 ? -0.5 : 0.5));
+}
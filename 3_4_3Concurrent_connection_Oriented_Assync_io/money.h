@@ -0,0 +1,36 @@
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Money is a signed count of cents everywhere: requests and responses,
+// accounts.db, the journal and the transaction logs. Decimal text is parsed
+// and printed by hand, so an amount never passes through a double and
+// repeated deposits cannot drift.
+typedef int64_t money_t;
+
+#define MONEY_UNITS(u) ((money_t)(u) * 100) // Whole units to cents
+#define MONEY_STR_LEN 24                    // Longest money_format output plus NUL
+
+// Parses "[-]digits[.d[d]]" exactly: at most two decimals, no spaces, no
+// exponent. Returns false on anything else or if the value does not fit.
+bool money_parse(const char* s, money_t* out);
+// Same for a token of len bytes that need not be NUL-terminated.
+bool money_parse_n(const char* s, size_t len, money_t* out);
+
+// Writes "-1234.56" (always two decimals) into out, which must hold
+// MONEY_STR_LEN bytes. Returns the length without the NUL.
+size_t money_format(char* out, money_t cents);
+
+// a + b and a - b, or false (and *out untouched) if the result would not fit
+// in a money_t. Every balance change goes through these: money_parse accepts
+// amounts up to about 9.2e16 units, so plain addition could overflow.
+bool money_add(money_t a, money_t b, money_t* out);
+bool money_sub(money_t a, money_t b, money_t* out);
+
+// Rounds a double to the nearest cent, for the legacy text formats only.
+money_t money_from_double(double amount);
+
+#endif // MONEY_H
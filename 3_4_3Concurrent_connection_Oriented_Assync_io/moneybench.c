@@ -0,0 +1,82 @@
+// moneybench - money_parse/money_format against the atof and "%.2f" calls
+// they replaced
+//
+//   ./moneybench [iterations]   (defaults to 10000000)
+//
+// Each loop runs over the same table of amounts; the sums are printed so the
+// work cannot be optimized away.
+#define _GNU_SOURCE // For clock_gettime under -std=c11
+#include "money.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define AMOUNT_COUNT 1024 // Power of two, indexed with a mask
+
+static char amounts[AMOUNT_COUNT][MONEY_STR_LEN];
+static money_t amount_cents[AMOUNT_COUNT];
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void report(const char* what, long iterations, double seconds) {
+    printf("%-14s %6.1f ns/op, %6.1fM ops/s\n", what, seconds * 1e9 / (double)iterations,
+           (double)iterations / seconds / 1e6);
+}
+
+int main(int argc, char* argv[]) {
+    long iterations = argc > 1 ? atol(argv[1]) : 10000000;
+    if (iterations <= 0) {
+        fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Balances and request amounts of the sizes the servers see
+    srand(1);
+    for (int i = 0; i < AMOUNT_COUNT; ++i) {
+        amount_cents[i] = (money_t)(rand() % 100000000) * (i % 4 + 1);
+        money_format(amounts[i], amount_cents[i]);
+    }
+
+    double t0 = now_sec();
+    double double_sum = 0;
+    for (long i = 0; i < iterations; ++i) double_sum += atof(amounts[i & (AMOUNT_COUNT - 1)]);
+    double t1 = now_sec();
+    money_t cents_sum = 0;
+    for (long i = 0; i < iterations; ++i) {
+        money_t v = 0;
+        money_parse(amounts[i & (AMOUNT_COUNT - 1)], &v);
+        cents_sum += v;
+    }
+    double t2 = now_sec();
+    report("atof", iterations, t1 - t0);
+    report("money_parse", iterations, t2 - t1);
+
+    char out[MONEY_STR_LEN];
+    size_t length_sum = 0;
+    t0 = now_sec();
+    for (long i = 0; i < iterations; ++i) {
+        length_sum += (size_t)snprintf(out, sizeof(out), "%.2f",
+                                       (double)amount_cents[i & (AMOUNT_COUNT - 1)] / 100.0);
+    }
+    t1 = now_sec();
+    for (long i = 0; i < iterations; ++i) length_sum += money_format(out, amount_cents[i & (AMOUNT_COUNT - 1)]);
+    t2 = now_sec();
+    report("snprintf %.2f", iterations, t1 - t0);
+    report("money_format", iterations, t2 - t1);
+
+    // Both parsers must agree on every entry in the table
+    for (int i = 0; i < AMOUNT_COUNT; ++i) {
+        money_t v = 0;
+        if (!money_parse(amounts[i], &v) || v != amount_cents[i] ||
+            money_from_double(atof(amounts[i])) != amount_cents[i]) {
+            fprintf(stderr, "Mismatch on %s\n", amounts[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    printf("(checksums %.2f %lld %zu)\n", double_sum, (long long)cents_sum, length_sum);
+    return EXIT_SUCCESS;
+}
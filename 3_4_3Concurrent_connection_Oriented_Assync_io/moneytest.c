@@ -0,0 +1,67 @@
+// moneytest - checks money_parse, money_format and the overflow-checked
+// balance arithmetic at the edges of money_t
+//
+//   make test
+//
+// Prints each failed check and exits non-zero if there was one.
+#include "money.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                 \
+    do {                                                            \
+        if (!(cond)) {                                              \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                             \
+        }                                                           \
+    } while (0)
+
+static void test_parse_bounds(void) {
+    money_t v;
+    CHECK(money_parse("92233720368547757.99", &v) && v == INT64_MAX - 8); // Largest accepted
+    CHECK(!money_parse("92233720368547758", &v)); // Whole part past MAX_WHOLE
+    CHECK(money_parse("0.01", &v) && v == 1);
+    CHECK(money_parse("12.5", &v) && v == 1250);
+    CHECK(!money_parse("1.005", &v));
+    CHECK(!money_parse("", &v));
+    CHECK(!money_parse("1e3", &v));
+}
+
+static void test_format(void) {
+    char buf[MONEY_STR_LEN];
+    money_format(buf, INT64_MAX);
+    CHECK(strcmp(buf, "92233720368547758.07") == 0);
+    money_format(buf, -5);
+    CHECK(strcmp(buf, "-0.05") == 0);
+}
+
+static void test_add_sub_bounds(void) {
+    money_t max_amount, v;
+    CHECK(money_parse("92233720368547757.99", &max_amount));
+
+    // A deposit the parser accepts must not wrap a balance negative
+    CHECK(!money_add(MONEY_UNITS(1000), max_amount, &v));
+    CHECK(money_add(0, max_amount, &v) && v == max_amount);
+    CHECK(money_add(INT64_MAX - 1, 1, &v) && v == INT64_MAX);
+    CHECK(!money_add(INT64_MAX, 1, &v));
+
+    v = 42;
+    CHECK(!money_sub(INT64_MIN, 1, &v) && v == 42); // Untouched on failure
+    CHECK(money_sub(MONEY_UNITS(1000), max_amount, &v) && v == MONEY_UNITS(1000) - max_amount);
+    CHECK(money_sub(INT64_MIN + 1, 1, &v) && v == INT64_MIN);
+}
+
+int main(void) {
+    test_parse_bounds();
+    test_format();
+    test_add_sub_bounds();
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("moneytest: all checks passed\n");
+    return EXIT_SUCCESS;
+}
@@ -1,5 +1,11 @@
 #define _GNU_SOURCE // Must be first
 #include "common.h"
+#include "account_index.h"
+#include "journal.h"
+#include "acct_alloc.h"
+#include "txn_log.h"
+#include "txn_ring.h"
+#include "money.h"
 #include <stdio.h>  // For fileno, fopen, etc.
 #include <stdlib.h>
 #include <string.h>
@@ -14,28 +20,40 @@
 #include <sys/file.h>    // For flock
 #include <fcntl.h>       // For fcntl
 
-#define DB_FILENAME "data.txt"
+#define DB_FILENAME "data.txt"        // Legacy text store, imported once into ACCOUNT_DB_FILENAME
+#define ACCOUNT_DB_FILENAME "accounts.db"
+#define JOURNAL_FILENAME "data.journal"
 #define MAX_ARGS 5       // Max arguments for parse_message
 
+// data.txt is rewritten only when either limit is reached
+#define CHECKPOINT_EVERY_RECORDS 1000
+#define CHECKPOINT_INTERVAL_SEC 30
+
+// Recent-transaction cache behind STATEMENT; override with -D at build time
+#ifndef STATEMENT_RING_SIZE
+#define STATEMENT_RING_SIZE 16            // Lines kept per cached account
+#endif
+#ifndef STATEMENT_CACHE_BYTES
+#define STATEMENT_CACHE_BYTES (8u << 20)  // Memory budget for all rings
+#endif
+
 // Forward declarations (prototypes)
 char* handle_client_operation(const char* received_message);
-static void log_transaction(const char* account_no, const char* type, double amount, double balance_after);
+static void log_transaction(const char* account_no, TxnOp op, money_t amount, money_t balance_after);
 static char* create_response(const char* status, const char* arg1, const char* arg2);
 static bool parse_message(const char* message, char* operation, char args[MAX_ARGS][MAX_LINE_LEN], int* arg_count);
 static void trim(char* str);
 // Note: is_valid_account_no is not static in the current file, so no prototype here unless changed.
 // bool is_valid_account_no(const char* account_no);
-// bool is_valid_amount_str(const char* amount_str); // Not static either
+// bool parse_amount_str(const char* amount_str, money_t* out); // Not static either
 static void generate_pin(char* pin_out);
-static void generate_account_no(char* acct_out);
+static bool generate_account_no(char* acct_out);
 static bool verify_pin(const char* account_no, const char* pin); // Already had this one
 static bool account_exists(const char* account_no);
-static bool get_balance_internal(const char* account_no, double* balance);
-static bool update_balance(const char* account_no, double new_balance);
-static bool add_account_record(const char* account_no, const char* pin, const char* name, const char* national_id, const char* account_type, double initial_deposit);
-static void lock_file(FILE* file, bool exclusive);
-static void unlock_file(FILE* file);
-// bool is_valid_amount(double amount); // Also not static
+static bool get_balance_internal(const char* account_no, money_t* balance);
+static bool apply_balance_change(const char* account_no, const char* pin, TxnOp op, money_t amount, money_t* out_balance);
+static bool add_account_record(const char* account_no, const char* pin, const char* name, const char* national_id, const char* account_type, money_t initial_deposit);
+// bool is_valid_amount(money_t amount); // Also not static
 
 // Utility Functions (Copied and some made static)
 static void trim(char* str) {
@@ -56,191 +74,120 @@ bool is_valid_account_no(const char* account_no) {
     return true;
 }
 
-// Changed to is_valid_amount_str to take string input, as atof is done later
-bool is_valid_amount_str(const char* amount_str) {
-    if (!amount_str || !*amount_str) return false;
-    int dot_count = 0;
-    for (const char* p = amount_str; *p; ++p) {
-        if (*p == '.') {
-            dot_count++;
-            if (dot_count > 1) return false;
-        } else if (!isdigit((unsigned char)*p)) {
-            return false;
-        }
-    }
+// Validates and converts a request amount in one pass: digits with at most
+// one '.' and two decimals, no sign
+bool parse_amount_str(const char* amount_str, money_t* out) {
+    if (!amount_str || *amount_str == '-') return false;
     // Further validation (e.g. minimum amount) is business logic dependent
-    return true;
+    return money_parse(amount_str, out);
 }
 
-// Original is_valid_amount(double) can still be useful internally
-bool is_valid_amount(double amount) {
+// Original is_valid_amount can still be useful internally
+bool is_valid_amount(money_t amount) {
     return amount > 0; // Basic check, specific rules (e.g. min deposit) handled by logic funcs
 }
 
 
-// File I/O Functions (Copied and some made static)
-static void lock_file(FILE* file, bool exclusive) {
-#ifdef _WIN32
-    // Windows file locking - Placeholder, not fully implemented/tested for this project
-    // HANDLE hFile = (HANDLE)_get_osfhandle(_fileno(file));
-    // OVERLAPPED overlapped = {0};
-    // if (exclusive) {
-    //     LockFileEx(hFile, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped);
-    // } else {
-    //     LockFileEx(hFile, 0, 0, MAXDWORD, MAXDWORD, &overlapped);
-    // }
-#else
-    // Unix/Linux file locking
-    if (exclusive) {
-        flock(fileno(file), LOCK_EX);
-    } else {
-        flock(fileno(file), LOCK_SH);
-    }
-#endif
-}
-
-static void unlock_file(FILE* file) {
-#ifdef _WIN32
-    // HANDLE hFile = (HANDLE)_get_osfhandle(_fileno(file));
-    // OVERLAPPED overlapped = {0};
-    // UnlockFileEx(hFile, 0, MAXDWORD, MAXDWORD, &overlapped);
-#else
-    flock(fileno(file), LOCK_UN);
-#endif
-}
-
-// account_exists checks if an account number is present in the DB_FILENAME
+// account_exists checks if an account number is present in the account index
 // This version doesn't check PIN, just existence.
 static bool account_exists(const char* account_no) {
-    FILE* file = fopen(DB_FILENAME, "r");
-    if (!file) {
-        return false; // File doesn't exist, so account cannot exist
-    }
-    char line[MAX_LINE_LEN];
-    char file_acct[MAX_ACCT_LEN + 1]; // +1 for null terminator
-    bool found = false;
-
-    lock_file(file, false); // Lock for shared reading
-    while (fgets(line, sizeof(line), file)) {
-        // sscanf should parse account number, pin, name, national_id, type, balance
-        if (sscanf(line, "%s %*s %*s %*s %*s %*f", file_acct) == 1) {
-            if (strcmp(file_acct, account_no) == 0) {
-                found = true;
-                break;
-            }
-        }
-    }
-    unlock_file(file);
-    fclose(file);
-    return found;
+    return index_find(account_no) != NULL;
 }
 
 
 // get_balance: Retrieves balance for an account_no. PIN check is now responsibility of caller or higher-level func.
 // For server-side internal use where PIN might have been verified already.
 // The public 'balance' function for client requests will handle PIN.
-static bool get_balance_internal(const char* account_no, double* balance_out) {
-    FILE* file = fopen(DB_FILENAME, "r");
-    if (!file) return false;
-
-    char line[MAX_LINE_LEN];
-    char file_acct[MAX_ACCT_LEN + 1];
-    char name_buf[64], nid_buf[32], type_buf[16], pin_buf[10]; // Match bankv1.c sizes
-    double current_balance;
-    bool found = false;
-
-    lock_file(file, false);
-    while (fgets(line, sizeof(line), file)) {
-        if (sscanf(line, "%s %s %s %s %s %lf", file_acct, pin_buf, name_buf, nid_buf, type_buf, &current_balance) == 6) {
-            if (strcmp(file_acct, account_no) == 0) {
-                *balance_out = current_balance;
-                found = true;
-                break;
-            }
-        }
-    }
-    unlock_file(file);
-    fclose(file);
-    return found;
+static bool get_balance_internal(const char* account_no, money_t* balance_out) {
+    AccountRecord* rec = index_find(account_no);
+    if (!rec) return false;
+    *balance_out = rec->balance_cents;
+    return true;
 }
 
 
-bool update_balance(const char* account_no, double new_balance) {
-    FILE* file = fopen(DB_FILENAME, "r");
-    if (!file) {
-        perror("update_balance: DB_FILENAME read error");
+// DEPOSIT and WITHDRAW in one index lookup: checks the PIN and the minimum
+// balance on the slot it found, appends the journal record, stores the new
+// balance into the mapped slot and logs the transaction. *out_balance gets
+// the new balance for the response. The journal record is synced by the
+// event loop before the response goes out; the slot file itself is only
+// flushed by checkpoint().
+static bool apply_balance_change(const char* account_no, const char* pin, TxnOp op, money_t amount, money_t* out_balance) {
+    const char* what = op == TXN_DEPOSIT ? "Deposit" : "Withdrawal";
+    AccountRecord* rec = index_find(account_no);
+    if (!rec || strcmp(rec->pin, pin) != 0) {
+        fprintf(stderr, "%s failed: Invalid PIN for %s\n", what, account_no);
+        return false;
+    }
+
+    money_t new_balance;
+    bool fits = op == TXN_DEPOSIT ? money_add(rec->balance_cents, amount, &new_balance)
+                                  : money_sub(rec->balance_cents, amount, &new_balance);
+    if (!fits) {
+        fprintf(stderr, "%s failed: Balance of %s would overflow\n", what, account_no);
         return false;
     }
-    // Use a temporary file for atomic update
-    char temp_db_filename[20];
-    snprintf(temp_db_filename, sizeof(temp_db_filename), "temp_%d.txt", rand());
-
-    FILE* temp_file = fopen(temp_db_filename, "w");
-    if (!temp_file) {
-        perror("update_balance: temp_file create error");
-        fclose(file);
+    if (op == TXN_WITHDRAW && new_balance < MONEY_UNITS(1000)) { // Minimum balance to maintain
+        fprintf(stderr, "Withdrawal failed: Insufficient funds or would fall below minimum balance for %s\n", account_no);
         return false;
     }
 
-    char line[MAX_LINE_LEN];
-    char file_acct[MAX_ACCT_LEN + 1];
-    char file_pin[10], name[64], national_id[32], account_type[16]; // Increased sizes
-    double current_balance;
-    bool updated = false;
-
-    lock_file(file, true); // Exclusive lock for read and subsequent replace
-    lock_file(temp_file, true);
-
-    while (fgets(line, sizeof(line), file)) {
-        // Read all fields to write them back correctly
-        if (sscanf(line, "%s %s %63s %31s %15s %lf", file_acct, file_pin, name, national_id, account_type, &current_balance) == 6) {
-            if (strcmp(file_acct, account_no) == 0) {
-                fprintf(temp_file, "%s %s %s %s %s %.2f\n", file_acct, file_pin, name, national_id, account_type, new_balance);
-                updated = true;
-            } else {
-                fputs(line, temp_file); // Copy non-matching lines as is
-            }
-        } else {
-             fputs(line, temp_file); // Copy lines that don't match format (e.g. corrupted, or headers if any)
-        }
+    if (!journal_append(account_no, new_balance)) {
+        fprintf(stderr, "%s failed: Could not update balance for %s\n", what, account_no);
+        return false; // Slot untouched, so it still matches the journal
     }
+    rec->balance_cents = new_balance;
+    log_transaction(account_no, op, amount, new_balance);
+    if (out_balance) *out_balance = new_balance;
+    return true;
+}
 
-    unlock_file(temp_file);
-    fclose(temp_file);
-    unlock_file(file);
-    fclose(file);
+// Used by journal_replay at startup to re-apply balances newer than the last msync
+static bool apply_journal_balance(const char* account_no, money_t balance) {
+    AccountRecord* rec = index_find(account_no);
+    if (!rec) return false;
+    rec->balance_cents = balance;
+    return true;
+}
 
-    if (updated) {
-        if (remove(DB_FILENAME) != 0) {
-            perror("update_balance: Error removing original DB_FILENAME");
-            remove(temp_db_filename); // Clean up temp file
-            return false;
-        }
-        if (rename(temp_db_filename, DB_FILENAME) != 0) {
-            perror("update_balance: Error renaming temp_file to DB_FILENAME");
-            // Attempt to restore original if possible, or log critical error
-            return false;
-        }
-    } else {
-        remove(temp_db_filename); // No update was made, remove temp file
+static time_t last_checkpoint = 0;
+
+// Flushes dirty slots to ACCOUNT_DB_FILENAME, then drops the journal records they now cover.
+static bool checkpoint(void) {
+    if (!index_sync()) {
+        fprintf(stderr, "Checkpoint failed, keeping %zu journal records\n", journal_pending());
+        return false;
+    }
+    journal_reset();
+    last_checkpoint = time(NULL);
+    return true;
+}
+
+// Called from the event loop after every wakeup
+static void maybe_checkpoint(void) {
+    size_t pending = journal_pending();
+    if (pending == 0) return;
+    if (pending >= CHECKPOINT_EVERY_RECORDS || time(NULL) - last_checkpoint >= CHECKPOINT_INTERVAL_SEC) {
+        checkpoint();
     }
-    return updated;
 }
 
 // add_account is used by open_account. It doesn't check for existence, assumes caller does.
 // This is the low-level add. open_account is the business logic.
-static bool add_account_record(const char* account_no, const char* pin, const char* name, const char* national_id, const char* account_type, double initial_deposit) {
-    FILE* file = fopen(DB_FILENAME, "a"); // Append mode
-    if (!file) {
-        perror("add_account_record: Error opening DB_FILENAME for append");
+static bool add_account_record(const char* account_no, const char* pin, const char* name, const char* national_id, const char* account_type, money_t initial_deposit) {
+    AccountRecord rec = {0};
+    strncpy(rec.account_no, account_no, sizeof(rec.account_no) - 1);
+    strncpy(rec.pin, pin, sizeof(rec.pin) - 1);
+    strncpy(rec.name, name, sizeof(rec.name) - 1);
+    strncpy(rec.national_id, national_id, sizeof(rec.national_id) - 1);
+    strncpy(rec.account_type, account_type, sizeof(rec.account_type) - 1);
+    rec.balance_cents = initial_deposit;
+    if (!index_insert(&rec)) {
+        fprintf(stderr, "add_account_record: no slot available for %s\n", account_no);
         return false;
     }
-    lock_file(file, true); // Exclusive lock for appending
-    fprintf(file, "%s %s %s %s %s %.2f\n", account_no, pin, name, national_id, account_type, initial_deposit);
-    fflush(file); // Ensure data is written to disk
-    unlock_file(file);
-    fclose(file);
-    return true;
+    // New accounts have no journal record, so flush the slot right away
+    return index_sync();
 }
 
 // Helper to generate a random 4-digit PIN
@@ -251,35 +198,20 @@ static void generate_pin(char* pin_out) {
     sprintf(pin_out, "%04d", 1000 + rand() % 9000); // Generate 4-digit PIN
 }
 
-// Helper to generate a unique account number (simple incremental)
-static void generate_account_no(char* acct_out) {
-    FILE* file = fopen(DB_FILENAME, "r");
-    int max_acct_val = 100000; // Starting base account number
-    char line[MAX_LINE_LEN];
-    char file_acct_str[MAX_ACCT_LEN + 1];
-
-    if (file) {
-        lock_file(file, false);
-        while (fgets(line, sizeof(line), file)) {
-            if (sscanf(line, "%s %*s %*s %*s %*s %*f", file_acct_str) == 1) {
-                int current_acct_val = atoi(file_acct_str);
-                if (current_acct_val > max_acct_val) {
-                    max_acct_val = current_acct_val;
-                }
-            }
-        }
-        unlock_file(file);
-        fclose(file);
-    }
-    sprintf(acct_out, "%d", max_acct_val + 1);
+// Helper to generate a unique account number from the leased block
+static bool generate_account_no(char* acct_out) {
+    long next;
+    if (!acct_alloc_next(&next)) return false;
+    sprintf(acct_out, "%ld", next);
+    return true;
 }
 
 
-bool open_account(const char* name, const char* national_id, const char* account_type, char* out_account_no, char* out_pin, double initial_deposit) {
+bool open_account(const char* name, const char* national_id, const char* account_type, char* out_account_no, char* out_pin, money_t initial_deposit) {
     if (!name || !national_id || !account_type || !out_account_no || !out_pin) return false;
     if (strlen(name) == 0 || strlen(national_id) == 0 || strlen(account_type) == 0) return false;
 
-    if (initial_deposit < 1000.0) { // Minimum initial deposit
+    if (initial_deposit < MONEY_UNITS(1000)) { // Minimum initial deposit
         fprintf(stderr, "Initial deposit must be at least 1000.00\n");
         return false;
     }
@@ -288,15 +220,14 @@ bool open_account(const char* name, const char* national_id, const char* account
         return false;
     }
 
-    generate_account_no(out_account_no);
+    if (!generate_account_no(out_account_no)) return false;
     generate_pin(out_pin);
 
-    // It's possible (though unlikely with incremental account numbers) that a generated account_no could collide
-    // if records were manually deleted or if generation logic changes. A robust system might re-check existence here.
-    // For this version, we assume generate_account_no provides a unique number.
+    // Numbers come from a persistent counter that never goes backwards, so a
+    // closed account's number is never handed out again.
 
     if (add_account_record(out_account_no, out_pin, name, national_id, account_type, initial_deposit)) {
-        log_transaction(out_account_no, "OPEN_ACCOUNT", initial_deposit, initial_deposit);
+        log_transaction(out_account_no, TXN_OPEN_ACCOUNT, initial_deposit, initial_deposit);
         return true;
     }
     return false;
@@ -311,80 +242,37 @@ bool close_account(const char* account_no, const char* pin) {
     }
 
     // Check balance - some banks might require $0 balance before closing
-    double current_bal;
-    if(get_balance_internal(account_no, &current_bal) && current_bal != 0.0){
+    money_t current_bal;
+    if(get_balance_internal(account_no, &current_bal) && current_bal != 0){
         // For now, allow closing with balance. Money would be "lost" or need manual handling.
         // A real system would enforce $0 balance or transfer funds.
-        fprintf(stdout, "Warning: Closing account %s with non-zero balance: %.2f\n", account_no, current_bal);
-    }
-
-
-    FILE* file = fopen(DB_FILENAME, "r");
-    if (!file) {
-        perror("close_account: DB_FILENAME read error");
-        return false;
-    }
-    char temp_db_filename[20];
-    snprintf(temp_db_filename, sizeof(temp_db_filename), "temp_%d.txt", rand());
-    FILE* temp_file = fopen(temp_db_filename, "w");
-    if (!temp_file) {
-        perror("close_account: temp_file create error");
-        fclose(file);
-        return false;
+        char bal_str[MONEY_STR_LEN];
+        money_format(bal_str, current_bal);
+        fprintf(stdout, "Warning: Closing account %s with non-zero balance: %s\n", account_no, bal_str);
     }
 
-    char line[MAX_LINE_LEN];
-    char file_acct[MAX_ACCT_LEN + 1], file_pin_stored[10];
-    bool closed = false;
-
-    lock_file(file, true);
-    lock_file(temp_file, true);
-
-    while (fgets(line, sizeof(line), file)) {
-        // sscanf only needs to check account_no and pin for the decision to exclude.
-        if (sscanf(line, "%s %s %*s %*s %*s %*f", file_acct, file_pin_stored) == 2) {
-            if (strcmp(file_acct, account_no) == 0 && strcmp(file_pin_stored, pin) == 0) {
-                closed = true; // Found the account, skip writing it to temp_file (effectively deleting it)
-                continue;
-            }
-        }
-        fputs(line, temp_file); // Write other lines to temp_file
-    }
 
-    unlock_file(temp_file);
-    fclose(temp_file);
-    unlock_file(file);
-    fclose(file);
+    // verify_pin above guarantees the account is in the index. The checkpoint
+    // flushes the cleared slot together with any pending journal records.
+    bool closed = index_remove(account_no) && checkpoint();
 
     if (closed) {
-        if (remove(DB_FILENAME) != 0) {
-            perror("close_account: Error removing original DB_FILENAME");
-            remove(temp_db_filename);
-            return false;
-        }
-        if (rename(temp_db_filename, DB_FILENAME) != 0) {
-            perror("close_account: Error renaming temp_file to DB_FILENAME");
-            return false;
-        }
         // Also remove the transaction log file for the closed account
-        char transaction_log_filename[MAX_ACCT_LEN + 4 + 1]; // account_no + ".txt" + null
-        snprintf(transaction_log_filename, sizeof(transaction_log_filename), "%s.txt", account_no);
-        if (remove(transaction_log_filename) != 0) {
+        if (!txn_log_remove(account_no)) {
             perror("close_account: Error removing transaction log file");
             // This is not critical for account closure itself, so don't return false. Log it.
-            fprintf(stderr, "Warning: Could not remove transaction log %s for closed account %s\n", transaction_log_filename, account_no);
+            fprintf(stderr, "Warning: Could not remove transaction log for closed account %s\n", account_no);
         }
-        log_transaction(account_no, "CLOSE_ACCOUNT", 0, 0); // Log closure
-    } else {
-        remove(temp_db_filename); // Account not found or PIN incorrect, remove temp file
+        txn_ring_drop(account_no);
+        log_transaction(account_no, TXN_CLOSE_ACCOUNT, 0, 0); // Log closure
     }
     return closed;
 }
 
 
-bool deposit_extended(const char* account_no, const char* pin, double amount) {
+bool deposit_extended(const char* account_no, const char* pin, money_t amount, money_t* out_balance) {
     if (!is_valid_account_no(account_no) || !pin || strlen(pin) == 0) return false;
-    if (amount < 500.0) { // Minimum deposit amount
+    if (amount < MONEY_UNITS(500)) { // Minimum deposit amount
         fprintf(stderr, "Deposit amount must be at least 500.00\n");
         return false;
     }
@@ -392,30 +280,12 @@ bool deposit_extended(const char* account_no, const char* pin, double amount) {
          fprintf(stderr, "Invalid deposit amount.\n");
         return false;
     }
-
-    if (!verify_pin(account_no, pin)) {
-        fprintf(stderr, "Deposit failed: Invalid PIN for %s\n", account_no);
-        return false;
-    }
-
-    double current_balance;
-    if (!get_balance_internal(account_no, &current_balance)) {
-        fprintf(stderr, "Deposit failed: Could not retrieve balance for %s (account may not exist post-PIN check, data integrity issue)\n", account_no);
-        return false; // Should not happen if verify_pin passed and data is consistent
-    }
-
-    double new_balance = current_balance + amount;
-    if (update_balance(account_no, new_balance)) {
-        log_transaction(account_no, "DEPOSIT", amount, new_balance);
-        return true;
-    }
-    fprintf(stderr, "Deposit failed: Could not update balance for %s\n", account_no);
-    return false;
+    return apply_balance_change(account_no, pin, TXN_DEPOSIT, amount, out_balance);
 }
 
-bool withdraw_extended(const char* account_no, const char* pin, double amount) {
+bool withdraw_extended(const char* account_no, const char* pin, money_t amount, money_t* out_balance) {
     if (!is_valid_account_no(account_no) || !pin || strlen(pin) == 0) return false;
-    if (amount < 500.0) { // Minimum withdrawal amount
+    if (amount < MONEY_UNITS(500)) { // Minimum withdrawal amount
         fprintf(stderr, "Withdrawal amount must be at least 500.00\n");
         return false;
     }
@@ -423,34 +293,11 @@ bool withdraw_extended(const char* account_no, const char* pin, double amount) {
          fprintf(stderr, "Invalid withdrawal amount.\n");
         return false;
     }
-
-    if (!verify_pin(account_no, pin)) {
-        fprintf(stderr, "Withdrawal failed: Invalid PIN for %s\n", account_no);
-        return false;
-    }
-
-    double current_balance;
-    if (!get_balance_internal(account_no, &current_balance)) {
-        fprintf(stderr, "Withdrawal failed: Could not retrieve balance for %s\n", account_no);
-        return false;
-    }
-
-    if (current_balance - amount < 1000.0) { // Minimum balance to maintain
-        fprintf(stderr, "Withdrawal failed: Insufficient funds or would fall below minimum balance for %s\n", account_no);
-        return false;
-    }
-
-    double new_balance = current_balance - amount;
-    if (update_balance(account_no, new_balance)) {
-        log_transaction(account_no, "WITHDRAW", amount, new_balance);
-        return true;
-    }
-    fprintf(stderr, "Withdrawal failed: Could not update balance for %s\n", account_no);
-    return false;
+    return apply_balance_change(account_no, pin, TXN_WITHDRAW, amount, out_balance);
 }
 
 // 'balance' function for client requests - includes PIN check.
-bool balance(const char* account_no, const char* pin, double* out_balance) {
+bool balance(const char* account_no, const char* pin, money_t* out_balance) {
     if (!is_valid_account_no(account_no) || !pin || strlen(pin) == 0 || !out_balance) return false;
 
     if (!verify_pin(account_no, pin)) {
@@ -471,79 +318,32 @@ bool statement(const char* account_no, const char* pin, char transactions_out[5]
         return false;
     }
 
-    char transaction_log_filename[MAX_ACCT_LEN + 4 + 1]; // account_no + ".txt" + null
-    snprintf(transaction_log_filename, sizeof(transaction_log_filename), "%s.txt", account_no);
-
-    FILE* tf = fopen(transaction_log_filename, "r");
-    if (!tf) {
-        // It's not an error if the log file doesn't exist (e.g., no transactions yet).
-        // The client will receive an empty statement for RESP_OK.
-        return true; // No transactions, but PIN was valid and account exists.
+    TxnRecord records[TXN_TAIL_MAX];
+    int count = txn_ring_get(account_no, 5, records);
+    if (count < 0) {
+        // First statement for this account (or it was evicted): warm its ring
+        // from the log tail, a single pread since records are fixed-size. A
+        // missing log is not an error: the client gets an empty statement.
+        count = txn_log_tail(account_no, txn_ring_size(), records);
+        if (count < 0) return false;
+        txn_ring_load(account_no, records, count);
     }
 
-    char all_lines_buffer[5][MAX_LINE_LEN] = {{0}};
-    int line_count = 0;
-    char current_line[MAX_LINE_LEN];
-
-    lock_file(tf, false);
-    while (fgets(current_line, sizeof(current_line), tf)) {
-        // Remove newline characters from the line
-        char* nl = strchr(current_line, '\n');
-        if (nl) *nl = '\0';
-        nl = strchr(current_line, '\r'); // Also check for CR
-        if (nl) *nl = '\0';
-
-        if (line_count < 5) {
-            strncpy(all_lines_buffer[line_count], current_line, MAX_LINE_LEN - 1);
-            all_lines_buffer[line_count][MAX_LINE_LEN - 1] = '\0';
-        } else {
-            // Shift lines up to make space for the new line at the end
-            for (int i = 0; i < 4; ++i) {
-                strncpy(all_lines_buffer[i], all_lines_buffer[i+1], MAX_LINE_LEN -1);
-                 all_lines_buffer[i][MAX_LINE_LEN - 1] = '\0';
-            }
-            strncpy(all_lines_buffer[4], current_line, MAX_LINE_LEN - 1);
-            all_lines_buffer[4][MAX_LINE_LEN - 1] = '\0';
-        }
-        line_count++;
+    // Render only what is sent back
+    int first = count > 5 ? count - 5 : 0;
+    for (int i = first; i < count; ++i) {
+        txn_record_render(&records[i], transactions_out[i - first], MAX_LINE_LEN);
     }
-    unlock_file(tf);
-    fclose(tf);
-
-    // Copy the last 5 (or fewer) lines to transactions_out
-    // int start_index = (line_count < 5) ? 0 : line_count - 5; // This variable is unused.
-    int output_idx = 0;
-    for (int i = 0; i < 5; ++i) { // Iterate through the buffer which contains last 5 lines
-        if (strlen(all_lines_buffer[i]) > 0) {
-             strncpy(transactions_out[output_idx++], all_lines_buffer[i], MAX_LINE_LEN -1);
-             transactions_out[output_idx-1][MAX_LINE_LEN-1] = '\0';
-        }
-    }
-    return true; // Successfully retrieved transactions (or confirmed none exist)
+    return true;
 }
 
-void log_transaction(const char* account_no, const char* type, double amount, double balance_after) {
+void log_transaction(const char* account_no, TxnOp op, money_t amount, money_t balance_after) {
     if (!is_valid_account_no(account_no)) return;
 
-    char transaction_log_filename[MAX_ACCT_LEN + 4 + 1];
-    snprintf(transaction_log_filename, sizeof(transaction_log_filename), "%s.txt", account_no);
-
-    FILE* file = fopen(transaction_log_filename, "a");
-    if (!file) {
-        perror("log_transaction: Error opening transaction log file");
-        return;
+    TxnRecord record;
+    if (txn_log_append(account_no, op, amount, balance_after, &record)) {
+        txn_ring_push(account_no, &record);
     }
-
-    time_t now = time(NULL);
-    char time_buffer[32];
-    // Format time as YYYY-MM-DD HH:MM:SS
-    strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", localtime(&now));
-
-    lock_file(file, true);
-    fprintf(file, "%s: %s, Amt: %.2f, Bal: %.2f\n", time_buffer, type, amount, balance_after);
-    fflush(file);
-    unlock_file(file);
-    fclose(file);
 }
 
 // Simplified register_account, deposit, withdraw, check_balance from original bankv1.c
@@ -583,48 +383,38 @@ bool parse_message(const char* message, char* operation, char args[MAX_ARGS][MAX
     return true;
 }
 
+// Copies src to buf + *len, truncating at the end of a MAX_MSG_LEN buffer
+static void append_field(char* buf, size_t* len, const char* src) {
+    size_t n = strlen(src);
+    if (n > MAX_MSG_LEN - 1 - *len) n = MAX_MSG_LEN - 1 - *len;
+    memcpy(buf + *len, src, n);
+    *len += n;
+}
+
 char* create_response(const char* status, const char* arg1, const char* arg2) {
     static char response_buffer[MAX_MSG_LEN];
-    memset(response_buffer, 0, MAX_MSG_LEN);
 
     if (!status) return ""; // Should not happen
 
-    strncat(response_buffer, status, MAX_MSG_LEN - strlen(response_buffer) - 1);
+    // Tracks the length instead of rescanning the buffer for every strncat
+    size_t len = 0;
+    append_field(response_buffer, &len, status);
     if (arg1) {
-        strncat(response_buffer, " ", MAX_MSG_LEN - strlen(response_buffer) - 1);
-        strncat(response_buffer, arg1, MAX_MSG_LEN - strlen(response_buffer) - 1);
+        append_field(response_buffer, &len, " ");
+        append_field(response_buffer, &len, arg1);
     }
     if (arg2) {
-        strncat(response_buffer, " ", MAX_MSG_LEN - strlen(response_buffer) - 1);
-        strncat(response_buffer, arg2, MAX_MSG_LEN - strlen(response_buffer) - 1);
+        append_field(response_buffer, &len, " ");
+        append_field(response_buffer, &len, arg2);
     }
+    response_buffer[len] = '\0';
     return response_buffer;
 }
 
 // Helper function to verify PIN against stored PIN
 static bool verify_pin(const char* account_no, const char* pin_attempt) {
-    FILE* file = fopen(DB_FILENAME, "r");
-    if (!file) {
-        perror("verify_pin: DB_FILENAME read error");
-        return false;
-    }
-    char line[MAX_LINE_LEN];
-    char file_acct[MAX_ACCT_LEN + 1], file_pin_stored[10]; // Increased pin buffer
-    bool pin_ok = false;
-
-    lock_file(file, false);
-    while (fgets(line, sizeof(line), file)) {
-        // sscanf needs to parse account_no and pin_stored
-        if (sscanf(line, "%s %s %*s %*s %*s %*f", file_acct, file_pin_stored) == 2) {
-            if (strcmp(file_acct, account_no) == 0 && strcmp(file_pin_stored, pin_attempt) == 0) {
-                pin_ok = true;
-                break;
-            }
-        }
-    }
-    unlock_file(file);
-    fclose(file);
-    return pin_ok;
+    AccountRecord* rec = index_find(account_no);
+    return rec && strcmp(rec->pin, pin_attempt) == 0;
 }
 
 
@@ -641,8 +431,8 @@ char* handle_client_operation(const char* received_message) {
     if (strcmp(operation, OP_OPEN_ACCOUNT) == 0) {
         if (arg_count < 4) return create_response(RESP_INVALID_REQUEST, "Too few arguments for OPEN_ACCOUNT", NULL);
         // args[0]=name, args[1]=national_id, args[2]=account_type, args[3]=initial_deposit_str
-        if (!is_valid_amount_str(args[3])) return create_response(RESP_INVALID_AMOUNT, "Invalid deposit amount format", NULL);
-        double initial_deposit = atof(args[3]);
+        money_t initial_deposit;
+        if (!parse_amount_str(args[3], &initial_deposit)) return create_response(RESP_INVALID_AMOUNT, "Invalid deposit amount format", NULL);
         char new_acct_no[MAX_ACCT_LEN + 1];
         char new_pin[10];
 
@@ -656,19 +446,14 @@ char* handle_client_operation(const char* received_message) {
         if (arg_count < 3) return create_response(RESP_INVALID_REQUEST, "Too few arguments for DEPOSIT", NULL);
         // args[0]=account_no, args[1]=pin, args[2]=amount_str
         if (!is_valid_account_no(args[0])) return create_response(RESP_INVALID_REQUEST, "Invalid account number format", NULL);
-        if (!is_valid_amount_str(args[2])) return create_response(RESP_INVALID_AMOUNT, "Invalid deposit amount format", NULL);
-        double amount = atof(args[2]);
-
-        if (deposit_extended(args[0], args[1], amount)) {
-            double current_balance; // Fetch current balance to return
-            if (balance(args[0], args[1], &current_balance)) { // balance function now checks PIN
-                 char balance_str[MAX_AMT_LEN + 1];
-                 snprintf(balance_str, sizeof(balance_str), "%.2f", current_balance);
-                 return create_response(RESP_OK, balance_str, "Deposit successful");
-            } else {
-                 // This case should ideally not be reached if deposit_extended succeeded and data is consistent
-                 return create_response(RESP_OK, "Deposited", "Balance unavailable post-deposit");
-            }
+        money_t amount;
+        if (!parse_amount_str(args[2], &amount)) return create_response(RESP_INVALID_AMOUNT, "Invalid deposit amount format", NULL);
+
+        money_t new_balance; // Returned by the same lookup that applied the deposit
+        if (deposit_extended(args[0], args[1], amount, &new_balance)) {
+            char balance_str[MONEY_STR_LEN];
+            money_format(balance_str, new_balance);
+            return create_response(RESP_OK, balance_str, "Deposit successful");
         } else {
             // deposit_extended logs details. Check for specific error like invalid PIN, insufficient funds etc.
             // For now, generic error.
@@ -678,18 +463,14 @@ char* handle_client_operation(const char* received_message) {
         if (arg_count < 3) return create_response(RESP_INVALID_REQUEST, "Too few arguments for WITHDRAW", NULL);
         // args[0]=account_no, args[1]=pin, args[2]=amount_str
         if (!is_valid_account_no(args[0])) return create_response(RESP_INVALID_REQUEST, "Invalid account number format", NULL);
-        if (!is_valid_amount_str(args[2])) return create_response(RESP_INVALID_AMOUNT, "Invalid withdrawal amount format", NULL);
-        double amount = atof(args[2]);
-
-        if (withdraw_extended(args[0], args[1], amount)) {
-            double current_balance;
-            if (balance(args[0], args[1], &current_balance)) {
-                char balance_str[MAX_AMT_LEN + 1];
-                snprintf(balance_str, sizeof(balance_str), "%.2f", current_balance);
-                return create_response(RESP_OK, balance_str, "Withdrawal successful");
-            } else {
-                return create_response(RESP_OK, "Withdrawn", "Balance unavailable post-withdrawal");
-            }
+        money_t amount;
+        if (!parse_amount_str(args[2], &amount)) return create_response(RESP_INVALID_AMOUNT, "Invalid withdrawal amount format", NULL);
+
+        money_t new_balance;
+        if (withdraw_extended(args[0], args[1], amount, &new_balance)) {
+            char balance_str[MONEY_STR_LEN];
+            money_format(balance_str, new_balance);
+            return create_response(RESP_OK, balance_str, "Withdrawal successful");
         } else {
             // Check if it was insufficient funds, invalid PIN, etc.
             // For now, a generic error. withdraw_extended logs specifics.
@@ -701,10 +482,10 @@ char* handle_client_operation(const char* received_message) {
          // args[0]=account_no, args[1]=pin
          if (!is_valid_account_no(args[0])) return create_response(RESP_INVALID_REQUEST, "Invalid account number format", NULL);
 
-         double current_balance;
+         money_t current_balance;
          if (balance(args[0], args[1], &current_balance)) { // balance function handles PIN check
-             char balance_str[MAX_AMT_LEN + 1];
-             snprintf(balance_str, sizeof(balance_str), "%.2f", current_balance);
+             char balance_str[MONEY_STR_LEN];
+             money_format(balance_str, current_balance);
              return create_response(RESP_OK, balance_str, NULL);
          } else {
              // balance function would have failed due to non-existent account or bad PIN
@@ -755,6 +536,43 @@ char* handle_client_operation(const char* received_message) {
 
 
 // Main Server Function
+// A response held back until the journal records it depends on are synced
+typedef struct {
+    int fd;
+    bool journaled; // The request appended to the journal
+    char text[MAX_MSG_LEN];
+} PendingReply;
+
+static void send_response(int epoll_fd, int fd, const char* response) {
+    printf("Sending to fd %d: [%s]\n", fd, response);
+    ssize_t sent_total = 0;
+    ssize_t response_len = strlen(response);
+    while(sent_total < response_len) {
+        // MSG_NOSIGNAL prevents SIGPIPE if client closed connection prematurely
+        ssize_t bytes_sent = send(fd, response + sent_total, response_len - sent_total, MSG_NOSIGNAL);
+        if (bytes_sent == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                fprintf(stdout, "Send would block for fd %d. Registering EPOLLOUT (basic).\n", fd);
+                // Store remaining response and register EPOLLOUT (simplified)
+                // For this subtask, we won't implement full buffer management for EPOLLOUT.
+                // We'll just set the flag and expect EPOLLOUT to trigger.
+                // A real implementation needs to store 'response + sent_total' and 'response_len - sent_total'.
+                struct epoll_event event;
+                event.events = EPOLLIN | EPOLLOUT | EPOLLET; // Keep EPOLLIN for further client requests
+                event.data.fd = fd;
+                epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+                return; // Don't try to send more now
+            } else {
+                perror("send error on client_fd");
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+                close(fd);
+                return;
+            }
+        }
+        sent_total += bytes_sent;
+    }
+}
+
 int main(int argc, char *argv[]) {
     int listen_fd;
     struct sockaddr_in server_addr;
@@ -766,6 +584,45 @@ int main(int argc, char *argv[]) {
     srand((unsigned int)time(NULL));
 
 
+    // Map the slot file once; every lookup after this is served from memory
+    bool db_created = false;
+    if (!index_open(ACCOUNT_DB_FILENAME, &db_created)) {
+        fprintf(stderr, "Failed to open accounts from %s\n", ACCOUNT_DB_FILENAME);
+        exit(EXIT_FAILURE);
+    }
+    // First start after the format change: convert the old text store
+    if (db_created && access(DB_FILENAME, F_OK) == 0) {
+        size_t imported = 0;
+        if (!index_import_text(DB_FILENAME, &imported) || !index_sync()) {
+            fprintf(stderr, "Failed to import %s into %s\n", DB_FILENAME, ACCOUNT_DB_FILENAME);
+            index_close();
+            remove(ACCOUNT_DB_FILENAME); // Retry the import on the next start
+            exit(EXIT_FAILURE);
+        }
+        printf("Imported %zu accounts from %s\n", imported, DB_FILENAME);
+    }
+    // Never hand out a number at or below one already in the store, e.g. after
+    // an import or if account.seq was lost
+    if (!acct_alloc_init(ACCT_SEQ_FILENAME, index_max_account_no() + 1, ACCT_LEASE_SIZE)) {
+        fprintf(stderr, "Failed to open account number counter %s\n", ACCT_SEQ_FILENAME);
+        exit(EXIT_FAILURE);
+    }
+    if (!txn_ring_init(STATEMENT_RING_SIZE, STATEMENT_CACHE_BYTES)) {
+        fprintf(stderr, "Failed to allocate the statement cache\n");
+        exit(EXIT_FAILURE);
+    }
+    // Balance changes made after the last checkpoint only exist in the journal
+    size_t replayed = 0;
+    if (!journal_replay(JOURNAL_FILENAME, apply_journal_balance, &replayed) || !journal_open(JOURNAL_FILENAME)) {
+        fprintf(stderr, "Failed to recover journal %s\n", JOURNAL_FILENAME);
+        exit(EXIT_FAILURE);
+    }
+    if (replayed > 0) {
+        printf("Replayed %zu journal records from %s\n", replayed, JOURNAL_FILENAME);
+        checkpoint();
+    }
+    last_checkpoint = time(NULL);
+
     if (argc == 2) { // User provided a port number
         port = atoi(argv[1]);
         if (port <= 0 || port > 65535) {
@@ -848,9 +705,13 @@ int main(int argc, char *argv[]) {
     printf("Server started. Waiting for connections on port %d using epoll...\n", port);
 
     char buffer[MAX_MSG_LEN]; // Reusable buffer for reads
+    static PendingReply replies[MAX_EVENTS]; // At most one reply per event
+    int reply_count = 0;
 
     while(1) {
-        int num_events = epoll_wait(epoll_fd, events, MAX_EVENTS, -1); // Wait indefinitely
+        // Wake up at least once per checkpoint interval so idle periods still flush the journal
+        int num_events = epoll_wait(epoll_fd, events, MAX_EVENTS, CHECKPOINT_INTERVAL_SEC * 1000);
+        maybe_checkpoint();
         if (num_events == -1) {
             if (errno == EINTR) continue; // Interrupted by signal, try again
             perror("epoll_wait failed");
@@ -963,37 +824,14 @@ int main(int argc, char *argv[]) {
                         trim(client_message);
                         printf("Received from fd %d: [%s]\n", current_fd, client_message);
 
+                        // Answered after the journal sync at the end of this wakeup
+                        size_t journaled_before = journal_pending();
                         char* response = handle_client_operation(client_message);
                         if (response) {
-                            printf("Sending to fd %d: [%s]\n", current_fd, response);
-                            ssize_t sent_total = 0;
-                            ssize_t response_len = strlen(response);
-                            while(sent_total < response_len) {
-                                // MSG_NOSIGNAL prevents SIGPIPE if client closed connection prematurely
-                                ssize_t bytes_sent = send(current_fd, response + sent_total, response_len - sent_total, MSG_NOSIGNAL);
-                                if (bytes_sent == -1) {
-                                    if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                                        fprintf(stdout, "Send would block for fd %d. Registering EPOLLOUT (basic).\n", current_fd);
-                                        // Store remaining response and register EPOLLOUT (simplified)
-                                        // For this subtask, we won't implement full buffer management for EPOLLOUT.
-                                        // We'll just set the flag and expect EPOLLOUT to trigger.
-                                        // A real implementation needs to store 'response + sent_total' and 'response_len - sent_total'.
-                                        event.events = EPOLLIN | EPOLLOUT | EPOLLET; // Keep EPOLLIN for further client requests
-                                        event.data.fd = current_fd;
-                                        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, current_fd, &event);
-                                        // Store this FD and its pending message separately if not using client_conn_t struct
-                                        // For now, this is a simplification.
-                                        goto next_event_loop; // Don't try to send more now
-                                    } else {
-                                        perror("send error on client_fd");
-                                        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, current_fd, NULL);
-                                        close(current_fd);
-                                        break;
-                                    }
-                                }
-                                sent_total += bytes_sent;
-                                if (sent_total >= response_len) break;
-                            }
+                            PendingReply* reply = &replies[reply_count++];
+                            reply->fd = current_fd;
+                            reply->journaled = journal_pending() != journaled_before;
+                            snprintf(reply->text, sizeof(reply->text), "%s", response);
                         }
                     }
                 } else if (events[i].events & EPOLLOUT) {
@@ -1018,12 +856,28 @@ int main(int argc, char *argv[]) {
             }
             next_event_loop:;
         }
+
+        // One fdatasync covers every balance change made during this wakeup
+        bool durable = journal_sync();
+        for (int r = 0; r < reply_count; ++r) {
+            const char* response = replies[r].text;
+            if (replies[r].journaled && !durable) {
+                response = create_response(RESP_ERROR, "Balance change could not be made durable", NULL);
+            }
+            send_response(epoll_fd, replies[r].fd, response);
+        }
+        reply_count = 0;
     }
 
     // Cleanup
     printf("Server shutting down.\n");
     close(listen_fd);
     if (epoll_fd != -1) close(epoll_fd);
+    if (journal_pending() > 0) checkpoint();
+    journal_close();
+    index_close();
+    txn_ring_shutdown();
+    txn_log_close_all();
 
     return 0;
 }
@@ -0,0 +1,159 @@
+#define _GNU_SOURCE // For fileno under -std=c11
+#include "text_loader.h"
+#include <pthread.h>
+#include <sys/file.h> // For flock
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MAX_LOADER_THREADS 64
+
+typedef struct {
+    const char* begin; // First byte of the chunk's first line
+    const char* end;   // One past the chunk's last newline (or end of file)
+    AccountRecord* records;
+    size_t count;
+    size_t capacity;
+    bool ok;           // False if the record array could not grow
+} Chunk;
+
+static bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Copies the next whitespace-separated token on the line into out (at most
+// max chars). Returns false at the end of the line or if the token is longer.
+static bool next_token(const char** p, const char* eol, char* out, size_t max) {
+    const char* s = *p;
+    while (s < eol && is_blank(*s)) s++;
+    const char* t = s;
+    while (t < eol && !is_blank(*t)) t++;
+    size_t len = (size_t)(t - s);
+    if (len == 0 || len > max) return false;
+    memcpy(out, s, len);
+    out[len] = '\0';
+    *p = t;
+    return true;
+}
+
+static bool parse_line(const char* p, const char* eol, AccountRecord* rec) {
+    char balance[64];
+    memset(rec, 0, sizeof(*rec));
+    return next_token(&p, eol, rec->account_no, MAX_ACCT_LEN) &&
+           next_token(&p, eol, rec->pin, sizeof(rec->pin) - 1) &&
+           next_token(&p, eol, rec->name, sizeof(rec->name) - 1) &&
+           next_token(&p, eol, rec->national_id, sizeof(rec->national_id) - 1) &&
+           next_token(&p, eol, rec->account_type, sizeof(rec->account_type) - 1) &&
+           next_token(&p, eol, balance, sizeof(balance) - 1) &&
+           money_parse(balance, &rec->balance_cents);
+}
+
+static void* parse_chunk(void* arg) {
+    Chunk* chunk = arg;
+    const char* p = chunk->begin;
+    while (p < chunk->end) {
+        const char* eol = memchr(p, '\n', (size_t)(chunk->end - p));
+        if (!eol) eol = chunk->end;
+
+        if (chunk->count == chunk->capacity) {
+            size_t new_capacity = chunk->capacity ? chunk->capacity * 2 : 4096;
+            AccountRecord* grown = realloc(chunk->records, new_capacity * sizeof(AccountRecord));
+            if (!grown) {
+                chunk->ok = false;
+                return NULL;
+            }
+            chunk->records = grown;
+            chunk->capacity = new_capacity;
+        }
+        if (parse_line(p, eol, &chunk->records[chunk->count])) chunk->count++;
+        p = eol + 1;
+    }
+    return NULL;
+}
+
+bool text_load_parallel(const char* filename, int threads, text_record_fn sink, void* arg,
+                        size_t* out_records) {
+    if (out_records) *out_records = 0;
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        perror("text_load_parallel: open failed");
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror("text_load_parallel: fstat failed");
+        close(fd);
+        return false;
+    }
+    size_t len = (size_t)st.st_size;
+    if (len == 0) {
+        close(fd);
+        return true;
+    }
+
+    flock(fd, LOCK_SH);
+    const char* map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("text_load_parallel: mmap failed");
+        flock(fd, LOCK_UN);
+        close(fd);
+        return false;
+    }
+    madvise((void*)map, len, MADV_SEQUENTIAL);
+
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    if (threads > MAX_LOADER_THREADS) threads = MAX_LOADER_THREADS;
+
+    // Cut at the first newline after each even split point
+    Chunk chunks[MAX_LOADER_THREADS];
+    memset(chunks, 0, sizeof(chunks));
+    const char* file_end = map + len;
+    const char* start = map;
+    for (int i = 0; i < threads; ++i) {
+        const char* cut = i == threads - 1 ? file_end : map + len / (size_t)threads * (size_t)(i + 1);
+        if (cut < start) cut = start;
+        if (cut < file_end) {
+            const char* nl = memchr(cut, '\n', (size_t)(file_end - cut));
+            cut = nl ? nl + 1 : file_end;
+        }
+        chunks[i].begin = start;
+        chunks[i].end = cut;
+        chunks[i].ok = true;
+        start = cut;
+    }
+
+    pthread_t tids[MAX_LOADER_THREADS];
+    bool started[MAX_LOADER_THREADS] = { false };
+    for (int i = 1; i < threads; ++i) {
+        started[i] = pthread_create(&tids[i], NULL, parse_chunk, &chunks[i]) == 0;
+    }
+    parse_chunk(&chunks[0]);
+    for (int i = 1; i < threads; ++i) {
+        if (started[i]) {
+            pthread_join(tids[i], NULL);
+        } else {
+            parse_chunk(&chunks[i]); // Could not start a thread; parse it here
+        }
+    }
+
+    munmap((void*)map, len);
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    // Merge in file order on this thread
+    bool ok = true;
+    size_t delivered = 0;
+    for (int i = 0; i < threads; ++i) {
+        if (!chunks[i].ok) {
+            fprintf(stderr, "text_load_parallel: out of memory parsing %s\n", filename);
+            ok = false;
+        }
+        for (size_t r = 0; ok && r < chunks[i].count; ++r) {
+            ok = sink(&chunks[i].records[r], arg);
+            if (ok) delivered++;
+        }
+        free(chunks[i].records);
+    }
+    if (out_records) *out_records = delivered;
+    return ok;
+}
@@ -0,0 +1,26 @@
+#ifndef TEXT_LOADER_H
+#define TEXT_LOADER_H
+
+#include "account_index.h"
+
+// Parallel parser for the legacy data.txt format
+// "%s %s %s %s %s %.2f" (account, pin, name, national id, type, balance).
+//
+// The file is mapped and split at newline boundaries into one chunk per
+// thread. Each thread tokenizes its chunk by hand (no sscanf) into a private
+// array; the arrays are then handed to the sink one record at a time, in file
+// order, on the calling thread. The sink therefore needs no locking and sees
+// duplicates in the same order a sequential reader would.
+//
+// Lines with fewer than six fields, a field longer than its record member, or
+// a balance money_parse rejects (e.g. an exponent or sub-cent digits) are
+// skipped.
+
+typedef bool (*text_record_fn)(const AccountRecord* rec, void* arg);
+
+// threads <= 0 uses one per online CPU. Stops and returns false if the sink
+// does. *out_records counts the records passed to the sink.
+bool text_load_parallel(const char* filename, int threads, text_record_fn sink, void* arg,
+                        size_t* out_records);
+
+#endif // TEXT_LOADER_H
@@ -0,0 +1,414 @@
+#define _GNU_SOURCE // For pread, flock
+#include "txn_log.h"
+#include "account_hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#define TXN_PATH_LEN 128
+
+// Logs live under TXN_LOG_DIR, spread over TXN_LOG_FANOUT levels of 256
+// subdirectories picked by a hash of the account number, e.g.
+// logs/3f/a2/100001.log, so no directory grows with the account count.
+// Override with -D at build time; 0 levels keeps every log in TXN_LOG_DIR.
+#ifndef TXN_LOG_DIR
+#define TXN_LOG_DIR "logs"
+#endif
+#ifndef TXN_LOG_FANOUT
+#define TXN_LOG_FANOUT 2
+#endif
+_Static_assert(TXN_LOG_FANOUT >= 0 && TXN_LOG_FANOUT <= 4, "one hash byte per level");
+
+// Open log descriptors kept between calls; override with -D at build time
+#ifndef TXN_FD_CACHE_MAX
+#define TXN_FD_CACHE_MAX 256
+#endif
+#define FD_BUCKETS (2 * TXN_FD_CACHE_MAX)
+#define NIL -1
+
+typedef struct {
+    char account_no[TXN_PATH_LEN];
+    int fd;
+    int chain;      // Next entry in the same hash bucket
+    int prev, next; // LRU list, most recent first; next also links free entries
+} FdEntry;
+
+static FdEntry fd_entries[TXN_FD_CACHE_MAX];
+static int fd_buckets[FD_BUCKETS];
+static int fd_capacity = -1; // Set on first use; 0 disables the cache
+static int lru_head = NIL, lru_tail = NIL, free_list = NIL;
+
+static const char* op_names[] = { "UNKNOWN", "OPEN_ACCOUNT", "DEPOSIT", "WITHDRAW", "CLOSE_ACCOUNT" };
+#define OP_COUNT (sizeof(op_names) / sizeof(op_names[0]))
+
+// Records keep whole seconds, so the coarse clock (the last tick, no
+// hardware counter read) is precise enough
+static int64_t txn_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    return (int64_t)ts.tv_sec;
+}
+
+const char* txn_op_name(uint8_t op) {
+    return op < OP_COUNT ? op_names[op] : op_names[0];
+}
+
+uint8_t txn_op_from_name(const char* name) {
+    for (uint8_t op = 1; op < OP_COUNT; ++op) {
+        if (strcmp(op_names[op], name) == 0) return op;
+    }
+    return 0;
+}
+
+// Per-thread "YYYY-MM-DD HH:MM:" of the last minute formatted. Zone offsets
+// and DST switches fall on whole minutes, so within one minute only the
+// seconds differ.
+static _Thread_local int64_t cached_minute = INT64_MIN;
+static _Thread_local char cached_prefix[TXN_TIME_LEN];
+static _Thread_local size_t cached_prefix_len = 0;
+
+void txn_format_time(int64_t timestamp, char* out) {
+    int64_t second = timestamp % 60;
+    if (second < 0) second += 60;
+    int64_t minute = timestamp - second;
+    if (minute != cached_minute) {
+        time_t when = (time_t)minute;
+        struct tm tm_buf;
+        cached_prefix_len = strftime(cached_prefix, sizeof(cached_prefix) - 2, "%Y-%m-%d %H:%M:",
+                                     localtime_r(&when, &tm_buf));
+        cached_minute = minute;
+    }
+    memcpy(out, cached_prefix, cached_prefix_len);
+    out[cached_prefix_len] = (char)('0' + second / 10);
+    out[cached_prefix_len + 1] = (char)('0' + second % 10);
+    out[cached_prefix_len + 2] = '\0';
+}
+
+void txn_record_render(const TxnRecord* rec, char* out, size_t out_len) {
+    char time_buffer[TXN_TIME_LEN], amount[MONEY_STR_LEN], balance[MONEY_STR_LEN];
+    txn_format_time(rec->timestamp, time_buffer);
+    money_format(amount, rec->amount_cents);
+    money_format(balance, rec->balance_cents);
+    snprintf(out, out_len, "%s: %s, Amt: %s, Bal: %s", time_buffer, txn_op_name(rec->op), amount, balance);
+}
+
+static void log_path(char* out, const char* account_no) {
+    uint32_t h = mix32(hash_account_no(account_no));
+
+    int len = snprintf(out, TXN_PATH_LEN, "%s/", TXN_LOG_DIR);
+    for (int level = 0; level < TXN_LOG_FANOUT; ++level, h >>= 8) {
+        len += snprintf(out + len, TXN_PATH_LEN - (size_t)len, "%02x/", (unsigned)(h & 0xff));
+    }
+    snprintf(out + len, TXN_PATH_LEN - (size_t)len, "%s.log", account_no);
+}
+
+// Where older servers kept the account's logs: <account_no><suffix> in the
+// working directory
+static void flat_path(char* out, const char* account_no, const char* suffix) {
+    snprintf(out, TXN_PATH_LEN, "%s%s", account_no, suffix);
+}
+
+// Creates the directories leading to path (the part before the last '/')
+static bool make_parent_dirs(const char* path) {
+    char dir[TXN_PATH_LEN];
+    snprintf(dir, sizeof(dir), "%s", path);
+    for (char* p = dir + 1; *p; ++p) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(dir, 0755) == -1 && errno != EEXIST) {
+            perror("txn_log: mkdir failed");
+            return false;
+        }
+        *p = '/';
+    }
+    return true;
+}
+
+// Parses one line of any text log format older servers wrote:
+//   3_4_3:        "2025-06-05 20:21:34: DEPOSIT, Amt: 500.00, Bal: 1500.00"
+//   3_4_1, 3_4_4: "DEPOSIT 500.00 1500.00 2025-06-05 20:21:34"
+static bool parse_text_line(const char* line, TxnRecord* rec) {
+    struct tm tm_buf;
+    memset(&tm_buf, 0, sizeof(tm_buf));
+    char type[32];
+    double amount, balance;
+
+    if (sscanf(line, "%d-%d-%d %d:%d:%d: %31[^,], Amt: %lf, Bal: %lf",
+               &tm_buf.tm_year, &tm_buf.tm_mon, &tm_buf.tm_mday,
+               &tm_buf.tm_hour, &tm_buf.tm_min, &tm_buf.tm_sec, type, &amount, &balance) != 9 &&
+        sscanf(line, "%31s %lf %lf %d-%d-%d %d:%d:%d", type, &amount, &balance,
+               &tm_buf.tm_year, &tm_buf.tm_mon, &tm_buf.tm_mday,
+               &tm_buf.tm_hour, &tm_buf.tm_min, &tm_buf.tm_sec) != 9) {
+        return false;
+    }
+    uint8_t op = txn_op_from_name(type);
+    if (op == 0) return false;
+
+    tm_buf.tm_year -= 1900;
+    tm_buf.tm_mon -= 1;
+    tm_buf.tm_isdst = -1;
+    memset(rec, 0, sizeof(*rec));
+    rec->timestamp = (int64_t)mktime(&tm_buf);
+    rec->amount_cents = money_from_double(amount);
+    rec->balance_cents = money_from_double(balance);
+    rec->op = op;
+    return true;
+}
+
+// Appends the records of a text log to fd, numbering them from first_seq
+static bool import_into(const char* txt_filename, int fd, uint32_t first_seq, size_t* out_records) {
+    FILE* in = fopen(txt_filename, "r");
+    if (!in) return false;
+
+    char line[512];
+    TxnRecord rec;
+    uint32_t seq = first_seq;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), in)) {
+        if (!parse_text_line(line, &rec)) continue;
+        rec.seq = seq++;
+        ok = write(fd, &rec, sizeof(rec)) == (ssize_t)sizeof(rec);
+    }
+    fclose(in);
+    if (!ok) perror("txn_log: import write failed");
+    if (out_records) *out_records = seq - first_seq;
+    return ok;
+}
+
+bool txn_log_import_text(const char* txt_filename, const char* log_filename, size_t* out_records) {
+    int fd = open(log_filename, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd == -1) {
+        perror("txn_log_import_text: cannot create binary log");
+        return false;
+    }
+    bool ok = import_into(txt_filename, fd, 0, out_records) && fsync(fd) == 0;
+    close(fd);
+    if (!ok) remove(log_filename);
+    return ok;
+}
+
+// The cache may use at most a quarter of the descriptor limit; the rest is
+// left for client sockets, the journal and accounts.db
+static void fd_cache_init(void) {
+    struct rlimit rl;
+    fd_capacity = TXN_FD_CACHE_MAX;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY && rl.rlim_cur / 4 < (rlim_t)fd_capacity) {
+        fd_capacity = (int)(rl.rlim_cur / 4);
+    }
+    for (int b = 0; b < FD_BUCKETS; ++b) fd_buckets[b] = NIL;
+    for (int e = 0; e < fd_capacity; ++e) fd_entries[e].next = e + 1 < fd_capacity ? e + 1 : NIL;
+    free_list = fd_capacity > 0 ? 0 : NIL;
+}
+
+static int* bucket_of(const char* account_no) {
+    return &fd_buckets[hash_account_no(account_no) % FD_BUCKETS];
+}
+
+static void lru_unlink(int e) {
+    FdEntry* entry = &fd_entries[e];
+    if (entry->prev != NIL) fd_entries[entry->prev].next = entry->next;
+    else lru_head = entry->next;
+    if (entry->next != NIL) fd_entries[entry->next].prev = entry->prev;
+    else lru_tail = entry->prev;
+}
+
+static void lru_push_front(int e) {
+    fd_entries[e].prev = NIL;
+    fd_entries[e].next = lru_head;
+    if (lru_head != NIL) fd_entries[lru_head].prev = e;
+    lru_head = e;
+    if (lru_tail == NIL) lru_tail = e;
+}
+
+static int fd_cache_entry(const char* account_no) {
+    if (fd_capacity < 0) fd_cache_init();
+    for (int e = *bucket_of(account_no); e != NIL; e = fd_entries[e].chain) {
+        if (strcmp(fd_entries[e].account_no, account_no) == 0) return e;
+    }
+    return NIL;
+}
+
+// The account's cached descriptor, marked most recently used; -1 if none
+static int fd_cache_find(const char* account_no) {
+    int e = fd_cache_entry(account_no);
+    if (e == NIL) return -1;
+    if (e != lru_head) {
+        lru_unlink(e);
+        lru_push_front(e);
+    }
+    return fd_entries[e].fd;
+}
+
+// Closes the entry's descriptor and returns it to the free list
+static void fd_cache_evict(int e) {
+    int* link = bucket_of(fd_entries[e].account_no);
+    while (*link != e) link = &fd_entries[*link].chain;
+    *link = fd_entries[e].chain;
+    lru_unlink(e);
+    close(fd_entries[e].fd);
+    fd_entries[e].next = free_list;
+    free_list = e;
+}
+
+// Takes ownership of fd unless the cache is disabled (returns false)
+static bool fd_cache_insert(const char* account_no, int fd) {
+    if (fd_capacity <= 0) return false;
+    if (free_list == NIL) fd_cache_evict(lru_tail);
+    int e = free_list;
+    free_list = fd_entries[e].next;
+    snprintf(fd_entries[e].account_no, sizeof(fd_entries[e].account_no), "%s", account_no);
+    fd_entries[e].fd = fd;
+    int* bucket = bucket_of(account_no);
+    fd_entries[e].chain = *bucket;
+    *bucket = e;
+    lru_push_front(e);
+    return true;
+}
+
+// Opens the account's log locked exclusively. The first open of an account
+// that still has a flat-layout log moves the .log into place, or converts
+// the .txt. Returns -1 (errno ENOENT) if there is no log and !create.
+static int open_log(const char* account_no, bool create) {
+    char path[TXN_PATH_LEN], flat_log[TXN_PATH_LEN], txt_path[TXN_PATH_LEN];
+    log_path(path, account_no);
+    flat_path(txt_path, account_no, ".txt");
+
+    int fd = open(path, O_RDWR | O_APPEND);
+    if (fd == -1 && errno == ENOENT) {
+        flat_path(flat_log, account_no, ".log");
+        bool flat = access(flat_log, F_OK) == 0;
+        if (flat || create || access(txt_path, F_OK) == 0) {
+            if (!make_parent_dirs(path)) return -1;
+            if (flat && rename(flat_log, path) == -1) {
+                perror("txn_log: cannot move flat log into place");
+                return -1;
+            }
+            fd = open(path, O_RDWR | O_APPEND | O_CREAT, 0644);
+        } else {
+            errno = ENOENT;
+        }
+    }
+    if (fd == -1) return -1;
+    flock(fd, LOCK_EX);
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size == 0 && access(txt_path, F_OK) == 0) {
+        size_t imported = 0;
+        if (import_into(txt_path, fd, 0, &imported) && fsync(fd) == 0) {
+            remove(txt_path);
+        } else if (ftruncate(fd, 0) == -1) { // Retry the conversion next time
+            perror("txn_log: ftruncate failed");
+        }
+    }
+    return fd;
+}
+
+// open_log through the descriptor cache. *cached is false if the caller
+// must close fd itself.
+static int acquire_log(const char* account_no, bool create, bool* cached) {
+    int fd = fd_cache_find(account_no);
+    *cached = fd != -1;
+    if (*cached) {
+        flock(fd, LOCK_EX);
+        return fd;
+    }
+    fd = open_log(account_no, create);
+    if (fd != -1) *cached = fd_cache_insert(account_no, fd);
+    return fd;
+}
+
+// Records in the log; a torn record at the end (crash mid-write) is cut off
+static uint32_t record_count(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) == -1) return 0;
+    off_t whole = st.st_size - st.st_size % (off_t)sizeof(TxnRecord);
+    if (whole != st.st_size && ftruncate(fd, whole) == -1) perror("txn_log: ftruncate failed");
+    return (uint32_t)(whole / (off_t)sizeof(TxnRecord));
+}
+
+bool txn_log_append(const char* account_no, uint8_t op, money_t amount, money_t balance_after, TxnRecord* out) {
+    bool cached;
+    int fd = acquire_log(account_no, true, &cached);
+    if (fd == -1) {
+        perror("txn_log_append: Error opening transaction log file");
+        return false;
+    }
+
+    TxnRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.timestamp = txn_now();
+    rec.amount_cents = amount;
+    rec.balance_cents = balance_after;
+    rec.seq = record_count(fd);
+    rec.op = op;
+
+    bool ok = write(fd, &rec, sizeof(rec)) == (ssize_t)sizeof(rec);
+    if (!ok) perror("txn_log_append: write failed");
+    flock(fd, LOCK_UN);
+    if (!cached) close(fd);
+
+    if (ok && out) *out = rec;
+    return ok;
+}
+
+int txn_log_tail(const char* account_no, int max_records, TxnRecord* out) {
+    if (max_records > TXN_TAIL_MAX) max_records = TXN_TAIL_MAX;
+    if (max_records <= 0) return 0;
+
+    bool cached;
+    int fd = acquire_log(account_no, false, &cached);
+    if (fd == -1) {
+        if (errno == ENOENT) return 0; // No transactions logged yet
+        perror("txn_log_tail: Error opening transaction log file");
+        return -1;
+    }
+    flock(fd, LOCK_SH); // Conversion (if any) is done; readers can share
+
+    struct stat st;
+    int count = -1;
+    if (fstat(fd, &st) == 0) {
+        long total = (long)(st.st_size / (off_t)sizeof(TxnRecord));
+        count = total < max_records ? (int)total : max_records;
+        size_t bytes = (size_t)count * sizeof(TxnRecord);
+        off_t offset = (off_t)(total - count) * (off_t)sizeof(TxnRecord);
+        if (pread(fd, out, bytes, offset) != (ssize_t)bytes) {
+            perror("txn_log_tail: pread failed");
+            count = -1;
+        }
+    }
+    flock(fd, LOCK_UN);
+    if (!cached) close(fd);
+    return count;
+}
+
+bool txn_log_remove(const char* account_no) {
+    char path[TXN_PATH_LEN], flat_log[TXN_PATH_LEN], txt_path[TXN_PATH_LEN];
+    log_path(path, account_no);
+    flat_path(flat_log, account_no, ".log");
+    flat_path(txt_path, account_no, ".txt");
+    int e = fd_cache_entry(account_no);
+    if (e != NIL) fd_cache_evict(e);
+    remove(flat_log);
+    remove(txt_path);
+    return remove(path) == 0 || errno == ENOENT;
+}
+
+bool txn_log_migrate(const char* account_no) {
+    bool cached;
+    int fd = acquire_log(account_no, false, &cached);
+    if (fd == -1) return errno == ENOENT; // Nothing to move
+    flock(fd, LOCK_UN);
+    if (!cached) close(fd);
+    return true;
+}
+
+void txn_log_close_all(void) {
+    while (lru_head != NIL) fd_cache_evict(lru_head);
+}
@@ -0,0 +1,83 @@
+#ifndef TXN_LOG_H
+#define TXN_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "money.h"
+
+// Per-account binary transaction log, logs/xx/yy/<account_no>.log, where
+// xx/yy come from a hash of the account number (see TXN_LOG_DIR and
+// TXN_LOG_FANOUT in txn_log.c).
+//
+// The file is a flat array of fixed-size TxnRecords (native byte order), so
+// record i starts at i * sizeof(TxnRecord) and the last K records are a
+// single pread at the end of the file no matter how long the history is.
+// Money is stored in integer cents. Text is only produced on the way out,
+// by txn_record_render.
+//
+// Descriptors of recently used logs stay open (up to TXN_FD_CACHE_MAX, and
+// never more than a quarter of RLIMIT_NOFILE), so a busy account's append or
+// tail does not look up, open and close the file again. The log functions
+// are therefore not thread-safe; the server calls them from its event loop.
+//
+// Logs left in the working directory by older servers (<account_no>.log, or
+// <account_no>.txt in any of the line formats those servers used) are moved
+// or converted the first time the account's log is opened, or up front with
+// the txnmigrate tool.
+
+typedef enum {
+    TXN_OPEN_ACCOUNT = 1,
+    TXN_DEPOSIT,
+    TXN_WITHDRAW,
+    TXN_CLOSE_ACCOUNT
+} TxnOp;
+
+typedef struct {
+    int64_t timestamp;     // Unix time
+    int64_t amount_cents;
+    int64_t balance_cents; // Balance after the transaction
+    uint32_t seq;          // Record number within this log, from 0
+    uint8_t op;            // TxnOp
+    uint8_t reserved[3];
+} TxnRecord;
+
+_Static_assert(sizeof(TxnRecord) == 32, "record size is part of the file format");
+
+#define TXN_TAIL_MAX 64   // Upper bound on records returned by one txn_log_tail
+#define TXN_RENDER_LEN 96 // Enough for any txn_record_render line
+#define TXN_TIME_LEN 32   // txn_format_time output, with room for 5-digit years
+
+const char* txn_op_name(uint8_t op); // "DEPOSIT" etc., "UNKNOWN" for bad codes
+uint8_t txn_op_from_name(const char* name); // 0 if not a known operation
+
+// Writes "YYYY-MM-DD HH:MM:SS" (local time) into out, TXN_TIME_LEN bytes.
+// localtime_r and strftime run once per minute per thread; other calls copy
+// the cached prefix and append the seconds.
+void txn_format_time(int64_t timestamp, char* out);
+
+// Renders "YYYY-MM-DD HH:MM:SS: TYPE, Amt: 0.00, Bal: 0.00" (local time).
+void txn_record_render(const TxnRecord* rec, char* out, size_t out_len);
+
+// Appends one record to the account's log; *out (if not NULL) receives it.
+bool txn_log_append(const char* account_no, uint8_t op, money_t amount, money_t balance_after, TxnRecord* out);
+
+// Copies the last (up to) max_records records, oldest first, into out.
+// Returns the number copied, 0 when the account has no log, -1 on error.
+int txn_log_tail(const char* account_no, int max_records, TxnRecord* out);
+
+// Deletes the account's log (and any unconverted text log).
+bool txn_log_remove(const char* account_no);
+
+// Moves the account's flat-layout log into place now instead of on first
+// use. True if there was nothing to move.
+bool txn_log_migrate(const char* account_no);
+
+// Closes every cached log descriptor, e.g. at shutdown.
+void txn_log_close_all(void);
+
+// One-shot conversion of a text log into a new binary log file. Lines that
+// match none of the known formats are skipped.
+bool txn_log_import_text(const char* txt_filename, const char* log_filename, size_t* out_records);
+
+#endif // TXN_LOG_H
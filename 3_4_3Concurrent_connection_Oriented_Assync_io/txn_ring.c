@@ -0,0 +1,181 @@
+#include "txn_ring.h"
+#include "account_hash.h"
+#include <stdint.h>
+
+#define SLOT_EMPTY   -1
+#define SLOT_DELETED -2
+
+typedef struct {
+    char account_no[MAX_ACCT_LEN + 1]; // "" when the entry is free
+    bool referenced;                   // CLOCK bit, set on every hit
+    int head;                          // Index of the oldest record
+    int count;
+    TxnRecord* ring;                   // ring_size records in the shared pool
+} RingEntry;
+
+static int ring_size = 0;
+static RingEntry* entries = NULL;
+static TxnRecord* pool = NULL;
+static size_t entry_capacity = 0;
+static size_t clock_hand = 0;
+
+static int32_t* slots = NULL;  // account_no -> entry, open addressing
+static size_t slot_capacity = 0;
+static size_t slot_used = 0;   // Live + deleted slots
+
+// Returns the slot holding account_no, or -(free slot + 1) if absent
+static long probe(const char* account_no) {
+    size_t mask = slot_capacity - 1;
+    size_t i = hash_account_no(account_no) & mask;
+    long first_free = -1;
+
+    for (size_t n = 0; n < slot_capacity; ++n, i = (i + 1) & mask) {
+        int32_t s = slots[i];
+        if (s == SLOT_EMPTY) {
+            return -((first_free >= 0 ? first_free : (long)i) + 1);
+        }
+        if (s == SLOT_DELETED) {
+            if (first_free < 0) first_free = (long)i;
+            continue;
+        }
+        if (strcmp(entries[s].account_no, account_no) == 0) {
+            return (long)i;
+        }
+    }
+    return -(first_free + 1);
+}
+
+// Evictions leave tombstones behind; clear them once they crowd the table
+static void rebuild_slots(void) {
+    for (size_t i = 0; i < slot_capacity; ++i) slots[i] = SLOT_EMPTY;
+    slot_used = 0;
+    for (size_t e = 0; e < entry_capacity; ++e) {
+        if (entries[e].account_no[0] == '\0') continue;
+        slots[-probe(entries[e].account_no) - 1] = (int32_t)e;
+        slot_used++;
+    }
+}
+
+static void remove_entry(long slot) {
+    RingEntry* entry = &entries[slots[slot]];
+    entry->account_no[0] = '\0';
+    entry->count = 0;
+    slots[slot] = SLOT_DELETED;
+}
+
+// Picks a free entry, or evicts one that has not been hit since the clock
+// hand last passed it
+static RingEntry* claim_entry(void) {
+    for (size_t n = 0; n < 2 * entry_capacity; ++n) {
+        RingEntry* entry = &entries[clock_hand];
+        clock_hand = (clock_hand + 1) % entry_capacity;
+        if (entry->account_no[0] == '\0') return entry;
+        if (entry->referenced) {
+            entry->referenced = false;
+            continue;
+        }
+        remove_entry(probe(entry->account_no));
+        return entry;
+    }
+    return NULL; // Not reached: the second lap finds every bit cleared
+}
+
+bool txn_ring_init(int size, size_t budget_bytes) {
+    if (size < 1) size = 1;
+    if (size > TXN_TAIL_MAX) size = TXN_TAIL_MAX;
+    ring_size = size;
+
+    // Per cached account: the entry, its records, and two hash slots
+    size_t per_account = sizeof(RingEntry) + (size_t)size * sizeof(TxnRecord) + 2 * sizeof(int32_t);
+    entry_capacity = budget_bytes / per_account;
+    if (entry_capacity == 0) return true; // Cache disabled
+
+    slot_capacity = 1;
+    while (slot_capacity < 2 * entry_capacity) slot_capacity *= 2;
+
+    entries = calloc(entry_capacity, sizeof(RingEntry));
+    pool = malloc(entry_capacity * (size_t)size * sizeof(TxnRecord));
+    slots = malloc(slot_capacity * sizeof(int32_t));
+    if (!entries || !pool || !slots) {
+        perror("txn_ring_init: malloc failed");
+        txn_ring_shutdown();
+        return false;
+    }
+    for (size_t e = 0; e < entry_capacity; ++e) entries[e].ring = &pool[e * (size_t)size];
+    for (size_t i = 0; i < slot_capacity; ++i) slots[i] = SLOT_EMPTY;
+    slot_used = 0;
+    return true;
+}
+
+void txn_ring_shutdown(void) {
+    free(entries);
+    free(pool);
+    free(slots);
+    entries = NULL;
+    pool = NULL;
+    slots = NULL;
+    entry_capacity = slot_capacity = slot_used = 0;
+    clock_hand = 0;
+}
+
+int txn_ring_size(void) {
+    return ring_size;
+}
+
+int txn_ring_get(const char* account_no, int max, TxnRecord* out) {
+    if (entry_capacity == 0) return -1;
+    long pos = probe(account_no);
+    if (pos < 0) return -1;
+
+    RingEntry* entry = &entries[slots[pos]];
+    entry->referenced = true;
+
+    int n = entry->count < max ? entry->count : max;
+    int first = entry->head + entry->count - n; // Skip the older records
+    for (int i = 0; i < n; ++i) out[i] = entry->ring[(first + i) % ring_size];
+    return n;
+}
+
+static void push_record(RingEntry* entry, const TxnRecord* record) {
+    entry->ring[(entry->head + entry->count) % ring_size] = *record;
+    if (entry->count < ring_size) {
+        entry->count++;
+    } else {
+        entry->head = (entry->head + 1) % ring_size; // Overwrote the oldest
+    }
+}
+
+void txn_ring_load(const char* account_no, const TxnRecord* records, int count) {
+    if (entry_capacity == 0 || strlen(account_no) > MAX_ACCT_LEN) return;
+
+    long pos = probe(account_no);
+    RingEntry* entry;
+    if (pos >= 0) {
+        entry = &entries[slots[pos]];
+    } else {
+        entry = claim_entry();
+        if ((slot_used + 1) * 10 > slot_capacity * 7) rebuild_slots();
+        pos = probe(account_no); // The eviction/rebuild may have moved the free slot
+        size_t slot = (size_t)(-pos - 1);
+        if (slots[slot] == SLOT_EMPTY) slot_used++;
+        slots[slot] = (int32_t)(entry - entries);
+        snprintf(entry->account_no, sizeof(entry->account_no), "%s", account_no);
+    }
+
+    entry->head = 0;
+    entry->count = 0;
+    entry->referenced = true;
+    for (int i = (count > ring_size ? count - ring_size : 0); i < count; ++i) push_record(entry, &records[i]);
+}
+
+void txn_ring_push(const char* account_no, const TxnRecord* record) {
+    if (entry_capacity == 0) return;
+    long pos = probe(account_no);
+    if (pos >= 0) push_record(&entries[slots[pos]], record);
+}
+
+void txn_ring_drop(const char* account_no) {
+    if (entry_capacity == 0) return;
+    long pos = probe(account_no);
+    if (pos >= 0) remove_entry(pos);
+}
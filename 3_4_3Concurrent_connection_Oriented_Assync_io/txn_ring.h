@@ -0,0 +1,36 @@
+#ifndef TXN_RING_H
+#define TXN_RING_H
+
+#include "common.h"
+#include "txn_log.h"
+
+// In-memory cache of each account's most recent transaction records, so
+// STATEMENT is normally served without touching disk.
+//
+// Every cached account owns a ring of the last ring_size records. A ring is
+// created lazily, from the log tail, the first time the account's statement
+// is requested; after that log_transaction pushes new lines into it. The
+// number of cached accounts is bounded by a memory budget; when it is full
+// the least recently used ring (CLOCK approximation) is evicted.
+
+// ring_size is clamped to [1, TXN_TAIL_MAX]. A budget too small for a single
+// ring disables the cache (every lookup misses). Returns false if the
+// budget could not be allocated.
+bool txn_ring_init(int ring_size, size_t budget_bytes);
+void txn_ring_shutdown(void);
+int txn_ring_size(void);
+
+// Copies up to max of the account's newest records, oldest first, into out.
+// Returns the number copied, or -1 if the account is not cached.
+int txn_ring_get(const char* account_no, int max, TxnRecord* out);
+
+// Caches records (oldest first, e.g. from txn_log_tail) as the account's ring.
+void txn_ring_load(const char* account_no, const TxnRecord* records, int count);
+
+// Appends a record to the account's ring; no-op if the account is not cached.
+void txn_ring_push(const char* account_no, const TxnRecord* record);
+
+// Forgets the account, e.g. after it has been closed.
+void txn_ring_drop(const char* account_no);
+
+#endif // TXN_RING_H
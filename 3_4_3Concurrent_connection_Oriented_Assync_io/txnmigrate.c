@@ -0,0 +1,47 @@
+// txnmigrate: moves the transaction logs older servers kept in the working
+// directory (<account_no>.log, <account_no>.txt) into the hashed logs/
+// layout. The server also moves an account's log the first time it opens
+// it; this tool does it up front for every account. Run it from the
+// server's directory with the server stopped.
+//   ./txnmigrate
+#define _GNU_SOURCE // For DT_DIR
+#include "txn_log.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+
+int main(int argc, char* argv[]) {
+    if (argc != 1) {
+        fprintf(stderr, "usage: %s (run from the server's directory)\n", argv[0]);
+        return 1;
+    }
+    DIR* dir = opendir(".");
+    if (!dir) {
+        perror("txnmigrate: cannot read the working directory");
+        return 1;
+    }
+
+    int moved = 0, failures = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_type == DT_DIR) continue;
+        const char* name = entry->d_name;
+        size_t digits = strspn(name, "0123456789");
+        if (digits == 0 || digits >= 32 || (strcmp(name + digits, ".log") != 0 && strcmp(name + digits, ".txt") != 0)) {
+            continue;
+        }
+
+        char account_no[32];
+        snprintf(account_no, sizeof(account_no), "%.*s", (int)digits, name);
+        if (txn_log_migrate(account_no)) {
+            moved++;
+        } else {
+            fprintf(stderr, "Failed to migrate %s\n", name);
+            failures++;
+        }
+    }
+    closedir(dir);
+    txn_log_close_all();
+    printf("Migrated %d flat logs, %d failed\n", moved, failures);
+    return failures == 0 ? 0 : 1;
+}
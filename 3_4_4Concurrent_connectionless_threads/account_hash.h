@@ -0,0 +1,34 @@
+#ifndef ACCOUNT_HASH_H
+#define ACCOUNT_HASH_H
+
+#include <stdint.h>
+
+// The one account number hash of this server: the record cache, the filter
+// and the shard choice all start from hash_account_no.
+
+#define FNV1A_INIT 2166136261u
+#define FNV1A_PRIME 16777619u
+
+// FNV-1a over the account number digits
+static inline uint32_t hash_account_no(const char* account_no) {
+    uint32_t h = FNV1A_INIT;
+    for (const unsigned char* p = (const unsigned char*)account_no; *p; ++p) {
+        h ^= *p;
+        h *= FNV1A_PRIME;
+    }
+    return h;
+}
+
+// murmur3 finalizer. Sequential account numbers differ only in their last
+// digits, which FNV-1a leaves poorly spread; apply this wherever the bits
+// are used without a further probe (shard index, bucket, fingerprint).
+static inline uint32_t mix32(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+#endif // ACCOUNT_HASH_H
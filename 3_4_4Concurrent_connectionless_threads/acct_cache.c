@@ -0,0 +1,167 @@
+#include "acct_cache.h"
+#include "account_hash.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NIL -1
+
+typedef struct {
+    CachedAccount record;
+    int32_t chain;      // Next entry in the same hash bucket
+    int32_t prev, next; // LRU list, most recent first; next also links free entries
+} CacheEntry;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static CacheEntry* entries = NULL;
+static int32_t* heads = NULL; // Hash bucket -> first entry
+static uint32_t* bucket_gen = NULL; // Hash bucket -> puts and drops of its accounts
+static size_t capacity = 0;
+static size_t bucket_mask = 0;
+static size_t used = 0;
+static int32_t lru_head = NIL, lru_tail = NIL, free_list = NIL;
+static unsigned long hits = 0, misses = 0;
+
+bool acct_cache_init(size_t budget_bytes) {
+    // Each entry also needs a bucket head and generation; buckets are at
+    // least as many as entries
+    size_t per_entry = sizeof(CacheEntry) + 2 * (sizeof(int32_t) + sizeof(uint32_t));
+    size_t count = budget_bytes / per_entry;
+    if (count > INT32_MAX) count = INT32_MAX;
+    if (count == 0) return true;
+
+    size_t buckets = 1;
+    while (buckets < count) buckets *= 2;
+    entries = calloc(count, sizeof(CacheEntry));
+    heads = malloc(buckets * sizeof(int32_t));
+    bucket_gen = calloc(buckets, sizeof(uint32_t));
+    if (!entries || !heads || !bucket_gen) {
+        perror("acct_cache: allocation failed");
+        free(entries);
+        free(heads);
+        free(bucket_gen);
+        entries = NULL;
+        heads = NULL;
+        bucket_gen = NULL;
+        return false;
+    }
+    for (size_t b = 0; b < buckets; ++b) heads[b] = NIL;
+    for (size_t e = 0; e < count; ++e) entries[e].next = e + 1 < count ? (int32_t)(e + 1) : NIL;
+    free_list = 0;
+    capacity = count;
+    bucket_mask = buckets - 1;
+    return true;
+}
+
+static int32_t find(const char* account_no, uint32_t h) {
+    for (int32_t e = heads[h & bucket_mask]; e != NIL; e = entries[e].chain) {
+        if (strcmp(entries[e].record.account_no, account_no) == 0) return e;
+    }
+    return NIL;
+}
+
+static void lru_unlink(int32_t e) {
+    CacheEntry* entry = &entries[e];
+    if (entry->prev != NIL) entries[entry->prev].next = entry->next;
+    else lru_head = entry->next;
+    if (entry->next != NIL) entries[entry->next].prev = entry->prev;
+    else lru_tail = entry->prev;
+}
+
+static void lru_push_front(int32_t e) {
+    entries[e].prev = NIL;
+    entries[e].next = lru_head;
+    if (lru_head != NIL) entries[lru_head].prev = e;
+    lru_head = e;
+    if (lru_tail == NIL) lru_tail = e;
+}
+
+static void remove_entry(int32_t e) {
+    int32_t* link = &heads[hash_account_no(entries[e].record.account_no) & bucket_mask];
+    while (*link != e) link = &entries[*link].chain;
+    *link = entries[e].chain;
+    lru_unlink(e);
+    entries[e].next = free_list;
+    free_list = e;
+    used--;
+}
+
+// Updates the account's entry, or takes a free one (evicting the least
+// recently used if there is none), and moves it to the front
+static void store(const CachedAccount* record) {
+    uint32_t h = hash_account_no(record->account_no);
+    int32_t e = find(record->account_no, h);
+    if (e != NIL) {
+        lru_unlink(e);
+    } else {
+        if (free_list == NIL) remove_entry(lru_tail);
+        e = free_list;
+        free_list = entries[e].next;
+        entries[e].chain = heads[h & bucket_mask];
+        heads[h & bucket_mask] = e;
+        used++;
+    }
+    entries[e].record = *record;
+    lru_push_front(e);
+}
+
+bool acct_cache_get(const char* account_no, CachedAccount* out) {
+    pthread_mutex_lock(&cache_lock);
+    int32_t e = capacity ? find(account_no, hash_account_no(account_no)) : NIL;
+    if (e != NIL) {
+        *out = entries[e].record;
+        if (e != lru_head) {
+            lru_unlink(e);
+            lru_push_front(e);
+        }
+        hits++;
+    } else {
+        misses++;
+    }
+    pthread_mutex_unlock(&cache_lock);
+    return e != NIL;
+}
+
+uint64_t acct_cache_fill_ticket(const char* account_no) {
+    pthread_mutex_lock(&cache_lock);
+    uint64_t ticket = capacity ? bucket_gen[hash_account_no(account_no) & bucket_mask] : 0;
+    pthread_mutex_unlock(&cache_lock);
+    return ticket;
+}
+
+void acct_cache_fill(const CachedAccount* record, uint64_t ticket) {
+    pthread_mutex_lock(&cache_lock);
+    if (capacity && ticket == bucket_gen[hash_account_no(record->account_no) & bucket_mask]) store(record);
+    pthread_mutex_unlock(&cache_lock);
+}
+
+void acct_cache_put(const CachedAccount* record) {
+    pthread_mutex_lock(&cache_lock);
+    if (capacity) {
+        bucket_gen[hash_account_no(record->account_no) & bucket_mask]++;
+        store(record);
+    }
+    pthread_mutex_unlock(&cache_lock);
+}
+
+void acct_cache_drop(const char* account_no) {
+    pthread_mutex_lock(&cache_lock);
+    if (capacity) {
+        uint32_t h = hash_account_no(account_no);
+        bucket_gen[h & bucket_mask]++;
+        int32_t e = find(account_no, h);
+        if (e != NIL) remove_entry(e);
+    }
+    pthread_mutex_unlock(&cache_lock);
+}
+
+void acct_cache_stats(AcctCacheStats* out) {
+    pthread_mutex_lock(&cache_lock);
+    out->hits = hits;
+    out->misses = misses;
+    out->entries = used;
+    out->capacity = capacity;
+    out->bytes = capacity ? capacity * sizeof(CacheEntry) + (bucket_mask + 1) * (sizeof(int32_t) + sizeof(uint32_t)) : 0;
+    pthread_mutex_unlock(&cache_lock);
+}
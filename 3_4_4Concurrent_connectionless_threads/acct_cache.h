@@ -0,0 +1,56 @@
+#ifndef ACCT_CACHE_H
+#define ACCT_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Cache of parsed data.txt records, so a hot account is answered from memory
+// instead of a scan of the whole file on every request.
+//
+// The number of entries is bounded by a byte budget; when it is full the
+// least recently used entry is evicted. The server writes through: every
+// change to a data.txt shard is followed, under the shard's lock, by
+// acct_cache_put or acct_cache_drop. That assumes this server is the only
+// writer of the files.
+//
+// A reader that misses takes a ticket before scanning the file and hands it
+// back with the record it found. If a put or drop of the same account
+// happened in between, the scan may have seen the old line, so the fill is
+// ignored. Tickets are counted per hash bucket, so writes to other accounts
+// (short of a bucket collision) don't void the fill.
+//
+// All functions are thread-safe.
+
+typedef struct {
+    char account_no[16]; // MAX_ACCT_LEN
+    char pin[8];
+    double balance;
+} CachedAccount;
+
+typedef struct {
+    unsigned long hits;
+    unsigned long misses;
+    size_t entries;
+    size_t capacity;
+    size_t bytes; // Allocated for capacity entries and the hash table
+} AcctCacheStats;
+
+// A budget too small for a single entry disables the cache (every lookup
+// misses). Returns false if the budget could not be allocated.
+bool acct_cache_init(size_t budget_bytes);
+
+// Copies the account's record into out; false (and a miss) if not cached.
+bool acct_cache_get(const char* account_no, CachedAccount* out);
+
+uint64_t acct_cache_fill_ticket(const char* account_no);
+void acct_cache_fill(const CachedAccount* record, uint64_t ticket);
+
+// Write-through after data.txt changed: caches record as the current line,
+// or forgets the account after it has been closed.
+void acct_cache_put(const CachedAccount* record);
+void acct_cache_drop(const char* account_no);
+
+void acct_cache_stats(AcctCacheStats* out);
+
+#endif // ACCT_CACHE_H
@@ -0,0 +1,192 @@
+#include "acct_filter.h"
+#include "account_hash.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BUCKET_SLOTS 4
+#define MIN_BUCKETS 256 // Always a power of two
+#define MAX_KICKS 500   // Evictions tried before an add gives up
+
+typedef struct {
+    uint16_t fp[BUCKET_SLOTS]; // 0 marks a free slot
+} Bucket;
+
+static pthread_rwlock_t filter_lock = PTHREAD_RWLOCK_INITIALIZER;
+static Bucket* buckets = NULL;
+static size_t bucket_mask = 0;
+static size_t entries = 0;
+static bool rebuilding = false;
+static bool overflowed = false;           // An add lost a fingerprint
+static uint32_t kick_state = 2463534242u; // xorshift32, picks eviction victims
+
+static atomic_ulong lookups, rejected, bypassed, false_positives;
+static _Thread_local bool last_checked = false; // This thread's last lookup used the table
+
+// Low 32 bits pick the bucket, the top 16 the fingerprint. The halves are
+// mixed with different seeds so the fingerprint doesn't repeat bucket bits.
+static uint64_t filter_hash(const char* account_no) {
+    uint32_t h = hash_account_no(account_no);
+    return (uint64_t)mix32(h ^ 0x9e3779b9u) << 32 | mix32(h);
+}
+
+static uint16_t fingerprint(uint64_t h) {
+    uint16_t fp = (uint16_t)(h >> 48);
+    return fp ? fp : 1;
+}
+
+// The other bucket depends only on the fingerprint, so an entry can be moved
+// without knowing its account number
+static size_t alt_bucket(size_t bucket, uint16_t fp) {
+    return (bucket ^ ((size_t)fp * 0x5bd1e995u)) & bucket_mask;
+}
+
+static bool bucket_insert(size_t b, uint16_t fp) {
+    for (int i = 0; i < BUCKET_SLOTS; ++i) {
+        if (buckets[b].fp[i] == 0) {
+            buckets[b].fp[i] = fp;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool bucket_has(size_t b, uint16_t fp) {
+    for (int i = 0; i < BUCKET_SLOTS; ++i) {
+        if (buckets[b].fp[i] == fp) return true;
+    }
+    return false;
+}
+
+static bool bucket_delete(size_t b, uint16_t fp) {
+    for (int i = 0; i < BUCKET_SLOTS; ++i) {
+        if (buckets[b].fp[i] == fp) {
+            buckets[b].fp[i] = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t next_kick(void) {
+    kick_state ^= kick_state << 13;
+    kick_state ^= kick_state >> 17;
+    kick_state ^= kick_state << 5;
+    return kick_state;
+}
+
+bool acct_filter_rebuild_begin(size_t expected) {
+    // Start at most half full, so opens have room until the next rebuild
+    size_t count = MIN_BUCKETS;
+    while (count * BUCKET_SLOTS < expected * 2) count *= 2;
+
+    pthread_rwlock_wrlock(&filter_lock);
+    rebuilding = true;
+    overflowed = false;
+    entries = 0;
+    free(buckets);
+    buckets = calloc(count, sizeof(Bucket));
+    bucket_mask = buckets ? count - 1 : 0;
+    pthread_rwlock_unlock(&filter_lock);
+
+    if (!buckets) {
+        perror("acct_filter: calloc failed");
+        return false;
+    }
+    return true;
+}
+
+void acct_filter_rebuild_end(void) {
+    pthread_rwlock_wrlock(&filter_lock);
+    rebuilding = false;
+    pthread_rwlock_unlock(&filter_lock);
+}
+
+void acct_filter_add(const char* account_no) {
+    uint64_t h = filter_hash(account_no);
+    uint16_t fp = fingerprint(h);
+
+    pthread_rwlock_wrlock(&filter_lock);
+    if (buckets && !overflowed) {
+        size_t b = h & bucket_mask;
+        bool placed = bucket_insert(b, fp) || bucket_insert(alt_bucket(b, fp), fp);
+        if (!placed) {
+            // Both buckets full: evict a random entry to its other bucket
+            if (next_kick() & 1) b = alt_bucket(b, fp);
+            for (int kick = 0; kick < MAX_KICKS && !placed; ++kick) {
+                int victim = (int)(next_kick() % BUCKET_SLOTS);
+                uint16_t evicted = buckets[b].fp[victim];
+                buckets[b].fp[victim] = fp;
+                fp = evicted;
+                b = alt_bucket(b, fp);
+                placed = bucket_insert(b, fp);
+            }
+        }
+        if (placed) {
+            entries++;
+        } else {
+            overflowed = true; // fp belongs to some live account and has nowhere to go
+            fprintf(stderr, "acct_filter: table full at %zu entries, disabled until rebuilt\n", entries);
+        }
+    }
+    pthread_rwlock_unlock(&filter_lock);
+}
+
+void acct_filter_remove(const char* account_no) {
+    uint64_t h = filter_hash(account_no);
+    uint16_t fp = fingerprint(h);
+
+    pthread_rwlock_wrlock(&filter_lock);
+    if (buckets) {
+        size_t b = h & bucket_mask;
+        if (bucket_delete(b, fp) || bucket_delete(alt_bucket(b, fp), fp)) entries--;
+    }
+    pthread_rwlock_unlock(&filter_lock);
+}
+
+bool acct_filter_may_contain(const char* account_no) {
+    uint64_t h = filter_hash(account_no);
+    uint16_t fp = fingerprint(h);
+
+    pthread_rwlock_rdlock(&filter_lock);
+    bool maybe = true;
+    last_checked = buckets && !rebuilding && !overflowed;
+    if (last_checked) {
+        size_t b = h & bucket_mask;
+        maybe = bucket_has(b, fp) || bucket_has(alt_bucket(b, fp), fp);
+    }
+    pthread_rwlock_unlock(&filter_lock);
+
+    atomic_fetch_add_explicit(&lookups, 1, memory_order_relaxed);
+    if (!last_checked) {
+        atomic_fetch_add_explicit(&bypassed, 1, memory_order_relaxed);
+    } else if (!maybe) {
+        atomic_fetch_add_explicit(&rejected, 1, memory_order_relaxed);
+    }
+    return maybe;
+}
+
+bool acct_filter_needs_rebuild(void) {
+    pthread_rwlock_rdlock(&filter_lock);
+    bool needed = !buckets || rebuilding || overflowed ||
+                  entries * 10 > (bucket_mask + 1) * BUCKET_SLOTS * 9;
+    pthread_rwlock_unlock(&filter_lock);
+    return needed;
+}
+
+void acct_filter_note_false_positive(void) {
+    if (last_checked) atomic_fetch_add_explicit(&false_positives, 1, memory_order_relaxed);
+}
+
+void acct_filter_stats(AcctFilterStats* out) {
+    out->lookups = atomic_load_explicit(&lookups, memory_order_relaxed);
+    out->rejected = atomic_load_explicit(&rejected, memory_order_relaxed);
+    out->bypassed = atomic_load_explicit(&bypassed, memory_order_relaxed);
+    out->false_positives = atomic_load_explicit(&false_positives, memory_order_relaxed);
+    pthread_rwlock_rdlock(&filter_lock);
+    out->entries = entries;
+    out->capacity = buckets ? (bucket_mask + 1) * BUCKET_SLOTS : 0;
+    pthread_rwlock_unlock(&filter_lock);
+}
@@ -0,0 +1,47 @@
+#ifndef ACCT_FILTER_H
+#define ACCT_FILTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Cuckoo filter over the live account numbers in the data.txt shards, so a
+// request for an account that does not exist is turned away from memory
+// instead of after a full scan of its shard. Unlike a Bloom filter it can delete, which
+// CLOSE_ACCOUNT needs.
+//
+// Each account is a 16-bit fingerprint in one of two 4-slot buckets. A "no"
+// is always right. A "maybe" is wrong about 8 / 65536 of the time at full
+// load; the caller then finds nothing in the file and reports it through
+// acct_filter_note_false_positive so the rate shows up in the stats.
+//
+// All functions are thread-safe. Adds and removes must follow the file: the
+// server makes them under the same shard lock as the file change.
+
+typedef struct {
+    unsigned long lookups;         // acct_filter_may_contain calls
+    unsigned long rejected;        // ...that answered "no"
+    unsigned long bypassed;        // ...answered "maybe" unchecked (rebuilding or full)
+    unsigned long false_positives; // "maybe" answers the file did not confirm
+    size_t entries;
+    size_t capacity;               // Fingerprint slots
+} AcctFilterStats;
+
+// Until the matching _end, every lookup answers "maybe" while the filter is
+// emptied, resized for expected accounts and refilled with acct_filter_add.
+bool acct_filter_rebuild_begin(size_t expected);
+void acct_filter_rebuild_end(void);
+
+// An add only fails when both buckets and every eviction path are full; the
+// filter then answers "maybe" to everything until the next rebuild.
+void acct_filter_add(const char* account_no);
+void acct_filter_remove(const char* account_no);
+bool acct_filter_may_contain(const char* account_no);
+
+// True when an add failed or the table is over 90% full.
+bool acct_filter_needs_rebuild(void);
+
+// Counts only if this thread's last lookup was answered from the table.
+void acct_filter_note_false_positive(void);
+void acct_filter_stats(AcctFilterStats* out);
+
+#endif // ACCT_FILTER_H
@@ -0,0 +1,156 @@
+#include "db_shard.h"
+#include "common.h"
+#include "account_hash.h"
+#include <errno.h>
+#include <stdint.h>
+
+// A reshard writes the new shards as data.NN.new. Once they are all synced,
+// a manifest naming the new count is renamed to MANIFEST_NEW: that is the
+// commit point. finish_reshard then renames the new shards over the old
+// ones, removes what is left of the old layout and installs the manifest;
+// after a crash, db_shard_open runs it again.
+#define MANIFEST_NEW DB_SHARD_MANIFEST ".new"
+#define MANIFEST_TEMP DB_SHARD_MANIFEST ".tmp"
+
+static void staged_path(char* out, int shard) {
+    snprintf(out, DB_SHARD_PATH_LEN, "data.%02d.new", shard);
+}
+
+void db_shard_path(char* out, int shard) {
+    snprintf(out, DB_SHARD_PATH_LEN, "data.%02d.txt", shard);
+}
+
+// Mixed so sequential account numbers spread evenly over any shard count.
+// Changing this moves accounts between shards: existing stores would need a
+// reshard.
+int db_shard_of(const char* account_no, int shard_count) {
+    return (int)(mix32(hash_account_no(account_no)) % (uint32_t)shard_count);
+}
+
+// Returns the count in a manifest, or -1 (errno set) if it is missing or
+// malformed
+static int read_manifest(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) return -1;
+    int count = -1;
+    if (fscanf(file, "%d", &count) != 1 || count < 1 || count > DB_SHARD_MAX) {
+        count = -1;
+        errno = EINVAL;
+    }
+    fclose(file);
+    return count;
+}
+
+static bool write_manifest(const char* path, int count) {
+    FILE* file = fopen(MANIFEST_TEMP, "w");
+    if (!file) return false;
+    bool ok = fprintf(file, "%d\n", count) > 0;
+    ok = fflush(file) == 0 && fsync(fileno(file)) == 0 && ok;
+    fclose(file);
+    return ok && rename(MANIFEST_TEMP, path) == 0;
+}
+
+static void discard_staged(void) {
+    char path[DB_SHARD_PATH_LEN];
+    for (int s = 0; s < DB_SHARD_MAX; ++s) {
+        staged_path(path, s);
+        remove(path);
+    }
+}
+
+// Safe to repeat: every step either is done already or does the same thing
+static bool finish_reshard(int count) {
+    char path[DB_SHARD_PATH_LEN], staged[DB_SHARD_PATH_LEN];
+    for (int s = 0; s < count; ++s) {
+        staged_path(staged, s);
+        db_shard_path(path, s);
+        if (rename(staged, path) == -1 && errno != ENOENT) return false;
+    }
+    // Whatever the old layout was, none of it outside the new shards is live
+    for (int s = count; s < DB_SHARD_MAX; ++s) {
+        db_shard_path(path, s);
+        if (remove(path) == -1 && errno != ENOENT) return false;
+    }
+    if (remove(DB_FILENAME) == -1 && errno != ENOENT) return false;
+    return rename(MANIFEST_NEW, DB_SHARD_MANIFEST) == 0;
+}
+
+bool db_shard_open(int* out_count) {
+    int pending = read_manifest(MANIFEST_NEW);
+    if (pending > 0) {
+        if (!finish_reshard(pending)) {
+            perror("db_shard_open: cannot finish an interrupted reshard");
+            return false;
+        }
+    } else {
+        discard_staged(); // Left by a reshard that never committed
+    }
+
+    int count = read_manifest(DB_SHARD_MANIFEST);
+    if (count < 0) {
+        if (errno != ENOENT) {
+            perror("db_shard_open: cannot read " DB_SHARD_MANIFEST);
+            return false;
+        }
+        count = 0;
+    }
+    *out_count = count;
+    return true;
+}
+
+bool db_reshard(int new_count, long* out_accounts) {
+    if (new_count < 1 || new_count > DB_SHARD_MAX) {
+        fprintf(stderr, "db_reshard: shard count must be 1 to %d\n", DB_SHARD_MAX);
+        return false;
+    }
+    int old_count;
+    if (!db_shard_open(&old_count)) return false;
+
+    FILE* out[DB_SHARD_MAX] = { NULL };
+    char path[DB_SHARD_PATH_LEN], line[MAX_LINE_LEN], acct[MAX_ACCT_LEN];
+    bool ok = true;
+    for (int s = 0; ok && s < new_count; ++s) {
+        staged_path(path, s);
+        ok = (out[s] = fopen(path, "w")) != NULL;
+    }
+
+    // A legacy store is the one file data.txt
+    long accounts = 0;
+    int inputs = old_count > 0 ? old_count : 1;
+    for (int s = 0; ok && s < inputs; ++s) {
+        if (old_count > 0) {
+            db_shard_path(path, s);
+        } else {
+            snprintf(path, sizeof(path), "%s", DB_FILENAME);
+        }
+        FILE* in = fopen(path, "r");
+        if (!in) {
+            ok = errno == ENOENT; // No accounts were ever written there
+            continue;
+        }
+        while (ok && fgets(line, sizeof(line), in)) {
+            if (line[0] == TOMBSTONE_MARK || sscanf(line, "%15s", acct) != 1) continue;
+            FILE* shard = out[db_shard_of(acct, new_count)];
+            ok = fputs(line, shard) != EOF && (line[strlen(line) - 1] == '\n' || fputc('\n', shard) != EOF);
+            accounts++;
+        }
+        fclose(in);
+    }
+    for (int s = 0; s < new_count; ++s) {
+        if (!out[s]) continue;
+        ok = fflush(out[s]) == 0 && fsync(fileno(out[s])) == 0 && ok;
+        fclose(out[s]);
+    }
+    ok = ok && write_manifest(MANIFEST_NEW, new_count);
+    if (!ok) {
+        perror("db_reshard: cannot write the new shards");
+        discard_staged();
+        return false;
+    }
+    if (!finish_reshard(new_count)) {
+        perror("db_reshard: cannot switch to the new shards"); // db_shard_open retries
+        return false;
+    }
+    if (out_accounts) *out_accounts = accounts;
+    return true;
+}
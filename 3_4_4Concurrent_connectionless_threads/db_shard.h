@@ -0,0 +1,32 @@
+#ifndef DB_SHARD_H
+#define DB_SHARD_H
+
+#include <stdbool.h>
+
+// Layout of the account store: the lines of data.txt spread over shard files
+// data.00.txt ... data.NN.txt by a hash of the account number. Each shard is
+// locked, rewritten and compacted on its own, so a balance update rewrites
+// 1/N of the accounts and writers to different shards never wait for each
+// other.
+//
+// The shard count in use is recorded in DB_SHARD_MANIFEST. A store without a
+// manifest is either empty or a single data.txt from before sharding.
+#define DB_SHARD_MANIFEST "data.shards"
+#define DB_SHARD_MAX 100 // Shard numbers have two digits
+#define DB_SHARD_PATH_LEN 32
+#define TOMBSTONE_MARK '#' // First byte of a closed account's line
+
+int db_shard_of(const char* account_no, int shard_count);
+void db_shard_path(char* out, int shard); // DB_SHARD_PATH_LEN bytes
+
+// Finishes a reshard that was interrupted after its new files were complete
+// (or discards one that was not), then reads the shard count on disk into
+// *out_count: 0 for a legacy data.txt or no store at all.
+bool db_shard_open(int* out_count);
+
+// Moves every live line of the current layout into new_count shard files and
+// records new_count in the manifest; closed accounts are dropped on the way.
+// Crash-safe, but not while a server is using the store.
+bool db_reshard(int new_count, long* out_accounts);
+
+#endif // DB_SHARD_H
@@ -0,0 +1,27 @@
+// reshard: redistributes the account store over a new number of shard files
+// (data.00.txt ... data.NN.txt), or splits a legacy data.txt. Closed accounts
+// are dropped on the way. Run it from the server's directory with the server
+// stopped; the server also reshards by itself at startup when the store does
+// not match its DB_SHARDS.
+//   ./reshard 16
+#include "db_shard.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char* argv[]) {
+    int count = argc == 2 ? atoi(argv[1]) : 0;
+    if (count < 1 || count > DB_SHARD_MAX) {
+        fprintf(stderr, "usage: %s <shard count, 1 to %d>\n", argv[0], DB_SHARD_MAX);
+        return 1;
+    }
+
+    int old_count;
+    if (!db_shard_open(&old_count)) return 1;
+    long accounts = 0;
+    if (!db_reshard(count, &accounts)) {
+        fprintf(stderr, "Resharding failed; the store is unchanged or is finished on the next open\n");
+        return 1;
+    }
+    printf("Moved %ld accounts from %d to %d shard files\n", accounts, old_count ? old_count : 1, count);
+    return 0;
+}
@@ -1,5 +1,10 @@
 /* server.c - Fork-based concurrent server */
 #include "common.h"
+#include "acct_alloc.h"
+#include "acct_cache.h"
+#include "acct_filter.h"
+#include "db_shard.h"
+#include "txn_log.h"
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <fcntl.h>
@@ -22,6 +27,31 @@
     #include <unistd.h>
     #include <sys/file.h>
 #endif
+static long scan_db_at_startup(void);
+
+// Account store shard files (see db_shard.h); override with -D at build
+// time. A store with a different count is resharded at startup.
+#ifndef DB_SHARDS
+#define DB_SHARDS 8
+#endif
+
+// A closed account's line is not removed; its first byte is overwritten with
+// TOMBSTONE_MARK. The compactor thread drops such lines once they make up
+// COMPACT_GARBAGE_PCT percent of a shard (and at least COMPACT_MIN_DEAD).
+#define COMPACT_GARBAGE_PCT 25
+#define COMPACT_MIN_DEAD 32
+#define COMPACT_RETRY_SEC 5
+
+// The compactor thread also rebuilds the account filter when it fills up and
+// prints the filter and record cache counters this often
+#define STATS_REPORT_SEC 60
+
+// Parsed account records kept in memory (0 disables the cache). The
+// ACCOUNT_CACHE_BYTES environment variable overrides this default at startup.
+#ifndef ACCOUNT_CACHE_BYTES
+#define ACCOUNT_CACHE_BYTES (4u << 20)
+#endif
+
 // Business Logic Functions - will move to server.c in future versions
 char* process_request(const char* request);
 char* register_account(const char* account_no);
@@ -36,7 +66,6 @@ static void generate_pin(char* pin_out);
 // File I/O Functions - will move to server.c in future versions
 bool account_exists(const char* account_no);
 bool get_balance(const char* account_no, double* balance);
-bool update_balance(const char* account_no, double new_balance);
 bool add_account(const char* account_no, const char* pin, double initial_balance);
 void handle_client(int client_sock);
 // Extended function prototypes
@@ -46,11 +75,81 @@ bool withdraw_extended(const char* account_no, const char* pin, double amount);
 bool deposit_extended(const char* account_no, const char* pin, double amount);
 bool balance(const char* account_no, double* out_balance);
 bool statement(const char* account_no, const char* pin, char transactions[5][MAX_LINE_LEN]);
-void log_transaction(const char* account_no, const char* type, double amount, double balance);
+void log_transaction(const char* account_no, TxnOp op, double amount, double balance);
 // Add these prototypes
 static void lock_file(FILE* file, bool exclusive);
 static void unlock_file(FILE* file);
 bool check_pin(const char* account_no, const char* pin);
+static void* compactor_main(void* arg);
+static bool rebuild_filter(void);
+static bool lookup_account(const char* account_no, CachedAccount* out);
+
+// One per shard file. lock serializes the threads that change the file (and
+// the compactor); readers never take it, they see either the old or the
+// rewritten file, and both hold the same live accounts.
+typedef struct {
+    pthread_mutex_t lock;
+    char path[DB_SHARD_PATH_LEN];
+    char temp_path[DB_SHARD_PATH_LEN]; // For rewrites and compaction
+    long live_records;                 // Guarded by lock
+    long dead_records;
+} Shard;
+
+static Shard shards[DB_SHARDS];
+static bool update_balance_locked(Shard* shard, const char* account_no, double new_balance);
+
+// Result of apply_delta
+typedef enum {
+    DELTA_OK,
+    DELTA_NOT_FOUND,
+    DELTA_INSUFFICIENT_FUNDS,
+    DELTA_IO_ERROR
+} DeltaStatus;
+
+static DeltaStatus apply_delta(const char* account_no, double delta, double min_balance, bool log, double* out_balance);
+
+// Writers set compact_requested after a change that may need the compactor.
+// A writer holding a shard lock may take compact_lock, never the reverse.
+static pthread_mutex_t compact_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t compact_cond = PTHREAD_COND_INITIALIZER;
+static bool compact_requested = false; // Guarded by compact_lock
+
+static Shard* shard_for(const char* account_no) {
+    return &shards[db_shard_of(account_no, DB_SHARDS)];
+}
+
+static void wake_compactor(void) {
+    pthread_mutex_lock(&compact_lock);
+    compact_requested = true;
+    pthread_cond_signal(&compact_cond);
+    pthread_mutex_unlock(&compact_lock);
+}
+
+// Shards are always locked in index order
+static void lock_all_shards(void) {
+    for (int i = 0; i < DB_SHARDS; ++i) pthread_mutex_lock(&shards[i].lock);
+}
+
+static void unlock_all_shards(void) {
+    for (int i = DB_SHARDS - 1; i >= 0; --i) pthread_mutex_unlock(&shards[i].lock);
+}
+
+static bool open_shards(void) {
+    int on_disk;
+    if (!db_shard_open(&on_disk)) return false;
+    if (on_disk != DB_SHARDS) {
+        long accounts = 0;
+        printf("Resharding the account store from %d to %d files...\n", on_disk ? on_disk : 1, DB_SHARDS);
+        if (!db_reshard(DB_SHARDS, &accounts)) return false;
+        printf("Resharded %ld accounts\n", accounts);
+    }
+    for (int i = 0; i < DB_SHARDS; ++i) {
+        pthread_mutex_init(&shards[i].lock, NULL);
+        db_shard_path(shards[i].path, i);
+        snprintf(shards[i].temp_path, sizeof(shards[i].temp_path), "data.%02d.tmp", i);
+    }
+    return true;
+}
 
 typedef struct {
     char buffer[MAX_MSG_LEN];
@@ -74,7 +173,53 @@ void* handle_request(void* arg) {
     return NULL;
 }
 
+// The cache budget from the environment, or the built-in default if unset
+static bool account_cache_bytes(size_t* out) {
+    const char* value = getenv("ACCOUNT_CACHE_BYTES");
+    if (!value || !*value) {
+        *out = ACCOUNT_CACHE_BYTES;
+        return true;
+    }
+    char* end;
+    errno = 0;
+    unsigned long long bytes = strtoull(value, &end, 10);
+    if (errno != 0 || *end != '\0' || value[0] == '-' || bytes > SIZE_MAX) return false;
+    *out = (size_t)bytes;
+    return true;
+}
+
 int main() {
+    if (!open_shards()) {
+        fprintf(stderr, "Failed to open the account store\n");
+        exit(1);
+    }
+    // Request threads share the process-wide lease
+    if (!acct_alloc_init(ACCT_SEQ_FILENAME, scan_db_at_startup() + 1, ACCT_LEASE_SIZE)) {
+        fprintf(stderr, "Failed to open account number counter %s\n", ACCT_SEQ_FILENAME);
+        exit(1);
+    }
+    size_t cache_bytes;
+    if (!account_cache_bytes(&cache_bytes)) {
+        fprintf(stderr, "Invalid ACCOUNT_CACHE_BYTES: %s\n", getenv("ACCOUNT_CACHE_BYTES"));
+        exit(1);
+    }
+    if (!acct_cache_init(cache_bytes)) {
+        fprintf(stderr, "Failed to allocate the account cache\n");
+        exit(1);
+    }
+    // Before any request thread exists, so the shard locks are not needed yet
+    if (!rebuild_filter()) {
+        fprintf(stderr, "Failed to build the account filter from the account store\n");
+        exit(1);
+    }
+
+    pthread_t compactor;
+    if (pthread_create(&compactor, NULL, compactor_main, NULL) != 0) {
+        fprintf(stderr, "Failed to start the compactor thread\n");
+        exit(1);
+    }
+    pthread_detach(compactor);
+
     int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
     struct sockaddr_in serv_addr, cli_addr;
     serv_addr.sin_family = AF_INET;
@@ -268,17 +413,13 @@ char* deposit(const char* account_no, double amount) {
     if (!is_valid_amount(amount)) {
         return create_response(RESP_INVALID_AMOUNT, 0);
     }
-    if (!account_exists(account_no)) {
-        return create_response(RESP_ACCT_NOT_FOUND, 0);
-    }
-    if (!get_balance(account_no, &balance)) {
-        return create_response(RESP_ERROR, 0);
-    }
-    balance += amount;
-    if (update_balance(account_no, balance)) {
-        return create_response(RESP_OK, balance);
-    } else {
-        return create_response(RESP_ERROR, 0);
+    switch (apply_delta(account_no, amount, 0, false, &balance)) {
+        case DELTA_OK:
+            return create_response(RESP_OK, balance);
+        case DELTA_NOT_FOUND:
+            return create_response(RESP_ACCT_NOT_FOUND, 0);
+        default:
+            return create_response(RESP_ERROR, 0);
     }
 }
 
@@ -287,20 +428,15 @@ char* withdraw(const char* account_no, double amount) {
     if (!is_valid_amount(amount)) {
         return create_response(RESP_INVALID_AMOUNT, 0);
     }
-    if (!account_exists(account_no)) {
-        return create_response(RESP_ACCT_NOT_FOUND, 0);
-    }
-    if (!get_balance(account_no, &balance)) {
-        return create_response(RESP_ERROR, 0);
-    }
-    if (balance < amount) {
-        return create_response(RESP_INSUFFICIENT_FUNDS, balance);
-    }
-    balance -= amount;
-    if (update_balance(account_no, balance)) {
-        return create_response(RESP_OK, balance);
-    } else {
-        return create_response(RESP_ERROR, 0);
+    switch (apply_delta(account_no, -amount, 0, false, &balance)) {
+        case DELTA_OK:
+            return create_response(RESP_OK, balance);
+        case DELTA_NOT_FOUND:
+            return create_response(RESP_ACCT_NOT_FOUND, 0);
+        case DELTA_INSUFFICIENT_FUNDS:
+            return create_response(RESP_INSUFFICIENT_FUNDS, balance);
+        default:
+            return create_response(RESP_ERROR, 0);
     }
 }
 
@@ -317,59 +453,85 @@ char* check_balance(const char* account_no) {
 }
 
 bool account_exists(const char* account_no) {
-    FILE* file = fopen(DB_FILENAME, "r");
+    CachedAccount record;
+    return lookup_account(account_no, &record);
+}
+
+bool get_balance(const char* account_no, double* balance) {
+    CachedAccount record;
+    if (!lookup_account(account_no, &record)) return false;
+    *balance = record.balance;
+    return true;
+}
+
+// Finds the account's live record in the cache, or else by a scan of its
+// shard file that fills the cache. Unknown numbers are answered by the
+// filter without either.
+static bool lookup_account(const char* account_no, CachedAccount* out) {
+    if (!acct_filter_may_contain(account_no)) return false;
+    if (acct_cache_get(account_no, out)) return true;
+    uint64_t ticket = acct_cache_fill_ticket(account_no); // Before the scan, so a racing update voids the fill
+    FILE* file = fopen(shard_for(account_no)->path, "r");
     if (!file) {
         // File doesn't exist, no accounts exist
         return false;
     }
     char line[MAX_LINE_LEN];
-    char file_acct[MAX_ACCT_LEN];
     bool found = false;
     lock_file(file, false); // lock for reading
     while (fgets(line, MAX_LINE_LEN, file)) {
-        if (sscanf(line, "%s", file_acct) == 1) {
-            if (strcmp(file_acct, account_no) == 0) {
-                found = true;
-                break;
-            }
+        if (line[0] == TOMBSTONE_MARK) continue;
+        // Account, PIN, then skip to the 6th field (balance)
+        if (sscanf(line, "%15s %7s %*s %*s %*s %lf", out->account_no, out->pin, &out->balance) == 3 &&
+            strcmp(out->account_no, account_no) == 0) {
+            found = true;
+            break;
         }
     }
     unlock_file(file);
     fclose(file);
+    if (found) {
+        acct_cache_fill(out, ticket);
+    } else {
+        acct_filter_note_false_positive();
+    }
     return found;
 }
 
-bool get_balance(const char* account_no, double* balance) {
-    FILE* file = fopen(DB_FILENAME, "r");
-    if (!file) {
-        return false;
-    }
-    char line[MAX_LINE_LEN];
-    char file_acct[MAX_ACCT_LEN];
-    double file_balance;
-    bool found = false;
-    lock_file(file, false); // lock for reading
-    while (fgets(line, MAX_LINE_LEN, file)) {
-        // Skip to the 6th field (balance)
-        if (sscanf(line, "%s %*s %*s %*s %*s %lf", file_acct, &file_balance) == 2) {
-            if (strcmp(file_acct, account_no) == 0) {
-                *balance = file_balance;
-                found = true;
-                break;
-            }
-        }
+// Adds delta to the account's balance with the read, the check and the
+// write all under the shard lock, so concurrent requests on one account
+// cannot lose an update. A change that would leave the balance below
+// min_balance is refused; *out_balance receives the balance after the
+// change, or the unchanged balance if it was refused. With log set the
+// transaction is logged before the lock is released, so the log records
+// changes in the order they were applied.
+static DeltaStatus apply_delta(const char* account_no, double delta, double min_balance, bool log, double* out_balance) {
+    Shard* shard = shard_for(account_no);
+    CachedAccount record;
+    DeltaStatus status;
+    pthread_mutex_lock(&shard->lock);
+    if (!lookup_account(account_no, &record)) {
+        status = DELTA_NOT_FOUND;
+    } else if (delta < 0 && record.balance + delta < min_balance) {
+        status = DELTA_INSUFFICIENT_FUNDS;
+        *out_balance = record.balance;
+    } else if (!update_balance_locked(shard, account_no, record.balance + delta)) {
+        status = DELTA_IO_ERROR;
+    } else {
+        status = DELTA_OK;
+        *out_balance = record.balance + delta;
+        if (log) log_transaction(account_no, delta > 0 ? TXN_DEPOSIT : TXN_WITHDRAW, delta > 0 ? delta : -delta, *out_balance);
     }
-    unlock_file(file);
-    fclose(file);
-    return found;
+    pthread_mutex_unlock(&shard->lock);
+    return status;
 }
 
-bool update_balance(const char* account_no, double new_balance) {
-    FILE* file = fopen(DB_FILENAME, "r");
+static bool update_balance_locked(Shard* shard, const char* account_no, double new_balance) {
+    FILE* file = fopen(shard->path, "r");
     if (!file) {
         return false;
     }
-    FILE* temp = fopen("temp.txt", "w");
+    FILE* temp = fopen(shard->temp_path, "w");
     if (!temp) {
         fclose(file);
         return false;
@@ -377,6 +539,7 @@ bool update_balance(const char* account_no, double new_balance) {
     char line[MAX_LINE_LEN];
     char file_acct[MAX_ACCT_LEN], file_pin[8], name[64], national_id[32], account_type[16];
     double file_balance;
+    CachedAccount record;
     bool updated = false;
     lock_file(file, true);
     lock_file(temp, true);
@@ -384,6 +547,9 @@ bool update_balance(const char* account_no, double new_balance) {
         if (sscanf(line, "%s %s %s %s %s %lf", file_acct, file_pin, name, national_id, account_type, &file_balance) == 6) {
             if (strcmp(file_acct, account_no) == 0) {
                 fprintf(temp, "%s %s %s %s %s %.2f\n", file_acct, file_pin, name, national_id, account_type, new_balance);
+                snprintf(record.account_no, sizeof(record.account_no), "%s", file_acct);
+                snprintf(record.pin, sizeof(record.pin), "%s", file_pin);
+                record.balance = new_balance;
                 updated = true;
             } else {
                 fputs(line, temp);
@@ -396,23 +562,27 @@ bool update_balance(const char* account_no, double new_balance) {
     unlock_file(temp);
     fclose(file);
     fclose(temp);
-    if (remove(DB_FILENAME) != 0) {
-        perror("Error removing file");
-        return false;
-    }
-    if (rename("temp.txt", DB_FILENAME) != 0) {
+    // rename replaces the shard atomically: lock-free readers in
+    // lookup_account open either the old file or the new one, never neither
+    if (rename(shard->temp_path, shard->path) != 0) {
         perror("Error renaming file");
+        remove(shard->temp_path);
+        acct_cache_drop(account_no);
         return false;
     }
+    if (updated) acct_cache_put(&record);
     return updated;
 }
 
 bool add_account(const char* account_no, const char* pin, double initial_balance) {
-    FILE* file = fopen(DB_FILENAME, "a+");
+    Shard* shard = shard_for(account_no);
+    pthread_mutex_lock(&shard->lock);
+    FILE* file = fopen(shard->path, "a+");
     if (!file) {
-        file = fopen(DB_FILENAME, "w");
+        file = fopen(shard->path, "w");
         if (!file) {
             perror("Error creating database file");
+            pthread_mutex_unlock(&shard->lock);
             return false;
         }
     }
@@ -422,6 +592,15 @@ bool add_account(const char* account_no, const char* pin, double initial_balance
     fflush(file);
     unlock_file(file);
     fclose(file);
+    shard->live_records++;
+    CachedAccount record;
+    snprintf(record.account_no, sizeof(record.account_no), "%s", account_no);
+    snprintf(record.pin, sizeof(record.pin), "%s", pin);
+    record.balance = initial_balance;
+    acct_cache_put(&record);
+    acct_filter_add(account_no);
+    if (acct_filter_needs_rebuild()) wake_compactor();
+    pthread_mutex_unlock(&shard->lock);
     return true;
 }
 
@@ -453,18 +632,33 @@ static void generate_pin(char* pin_out) {
     sprintf(pin_out, "%04d", 1000 + rand() % 9000);
 }
 
-// Helper to generate a unique account number (incremental)
-static void generate_account_no(char* acct_out) {
-    FILE* file = fopen(DB_FILENAME, "r");
-    int max_acct = 100000; char line[MAX_LINE_LEN], acct[MAX_ACCT_LEN];
-    if (file) {
-        while (fgets(line, sizeof(line), file))
-            if (sscanf(line, "%s", acct) == 1) {
-                int n = atoi(acct); if (n > max_acct) max_acct = n;
+// Returns the highest account number in any shard (to seed the allocator)
+// and counts each shard's live and tombstoned lines for the compactor; the
+// only full scan made at startup
+static long scan_db_at_startup(void) {
+    long max_acct = 100000; char line[MAX_LINE_LEN], acct[MAX_ACCT_LEN];
+    for (int i = 0; i < DB_SHARDS; ++i) {
+        Shard* shard = &shards[i];
+        FILE* file = fopen(shard->path, "r");
+        if (!file) continue;
+        while (fgets(line, sizeof(line), file)) {
+            if (line[0] == TOMBSTONE_MARK) { shard->dead_records++; continue; }
+            shard->live_records++;
+            if (sscanf(line, "%15s", acct) == 1) {
+                long n = atol(acct); if (n > max_acct) max_acct = n;
             }
+        }
         fclose(file);
     }
-    sprintf(acct_out, "%d", max_acct + 1);
+    return max_acct;
+}
+
+// Helper to generate a unique account number (leased from account.seq)
+static bool generate_account_no(char* acct_out) {
+    long next;
+    if (!acct_alloc_next(&next)) return false;
+    sprintf(acct_out, "%ld", next);
+    return true;
 }
 
 // Creates an account with minimum 1k, stores name, national ID, type, generates account number and PIN
@@ -475,11 +669,14 @@ bool open_account(const char* name, const char* national_id, const char* account
         printf("Invalid account type. Must be 'savings' or 'checking'.\n");
         return false;
     }
-    generate_account_no(out_account_no);
+    if (!generate_account_no(out_account_no)) return false;
     generate_pin(out_pin);
-    FILE* file = fopen(DB_FILENAME, "a+");
+    Shard* shard = shard_for(out_account_no);
+    pthread_mutex_lock(&shard->lock);
+    FILE* file = fopen(shard->path, "a+");
     if (!file) {
         perror("Error opening database file");
+        pthread_mutex_unlock(&shard->lock);
         return false;
     }
     lock_file(file, true);
@@ -487,140 +684,211 @@ bool open_account(const char* name, const char* national_id, const char* account
     fflush(file);
     unlock_file(file);
     fclose(file);
+    shard->live_records++;
+    CachedAccount record;
+    snprintf(record.account_no, sizeof(record.account_no), "%s", out_account_no);
+    snprintf(record.pin, sizeof(record.pin), "%s", out_pin);
+    record.balance = initial_deposit;
+    acct_cache_put(&record);
+    acct_filter_add(out_account_no);
+    if (acct_filter_needs_rebuild()) wake_compactor();
+    pthread_mutex_unlock(&shard->lock);
     return true;
 }
 
-// Closes an account (marks as closed or removes from DB)
+static bool compaction_due(const Shard* shard) {
+    return shard->dead_records >= COMPACT_MIN_DEAD &&
+           shard->dead_records * 100 >= (shard->live_records + shard->dead_records) * COMPACT_GARBAGE_PCT;
+}
+
+// Closes an account by marking its line as a tombstone in place; the line
+// keeps its length, so nothing after it is rewritten
 bool close_account(const char* account_no, const char* pin) {
-    FILE* file = fopen(DB_FILENAME, "r");
-    if (!file) return false;
-    FILE* temp = fopen("temp.txt", "w");
-    if (!temp) {
-        fclose(file);
+    Shard* shard = shard_for(account_no);
+    pthread_mutex_lock(&shard->lock);
+    FILE* file = fopen(shard->path, "r+");
+    if (!file) {
+        pthread_mutex_unlock(&shard->lock);
         return false;
     }
     char line[MAX_LINE_LEN], file_acct[MAX_ACCT_LEN], file_pin[8];
     bool closed = false;
     lock_file(file, true);
-    lock_file(temp, true);
+    long offset = ftell(file);
     while (fgets(line, sizeof(line), file)) {
-        if (sscanf(line, "%s %s", file_acct, file_pin) == 2) {
-            if (strcmp(file_acct, account_no) == 0 && strcmp(file_pin, pin) == 0) {
-                closed = true;
-                continue;
-            }
+        if (line[0] != TOMBSTONE_MARK && sscanf(line, "%s %s", file_acct, file_pin) == 2 &&
+            strcmp(file_acct, account_no) == 0 && strcmp(file_pin, pin) == 0) {
+            closed = fseek(file, offset, SEEK_SET) == 0 && fputc(TOMBSTONE_MARK, file) != EOF &&
+                     fflush(file) == 0;
+            break;
         }
-        fputs(line, temp);
+        offset = ftell(file);
     }
     unlock_file(file);
-    unlock_file(temp);
     fclose(file);
-    fclose(temp);
-    remove(DB_FILENAME);
-    rename("temp.txt", DB_FILENAME);
-    char filename[64];
-    snprintf(filename, sizeof(filename), "%s.txt", account_no);
-    remove(filename);
+    if (closed) {
+        shard->live_records--;
+        shard->dead_records++;
+        acct_filter_remove(account_no);
+        acct_cache_drop(account_no);
+        if (compaction_due(shard)) wake_compactor();
+    }
+    pthread_mutex_unlock(&shard->lock);
+    txn_log_remove(account_no);
     return closed;
 }
 
-// Withdraws, leaving at least 1k, in units of >= 500
-bool withdraw_extended(const char* account_no, const char* pin, double amount) {
-    if (amount < 500) return false;
-    FILE* db = fopen(DB_FILENAME, "r+");
-    if (!db) return false;
-    char line[MAX_LINE_LEN], file_acct[MAX_ACCT_LEN], file_pin[8], name[64], national_id[32], account_type[16];
-    double balance = 0;
-    bool found = false;
-    while (fgets(line, sizeof(line), db)) {
-        if (sscanf(line, "%s %s %s %s %s %lf", file_acct, file_pin, name, national_id, account_type, &balance) == 6) {
-            if (strcmp(file_acct, account_no) == 0 && strcmp(file_pin, pin) == 0) {
-                found = true;
-                break;
-            }
+// Copies every live line of the shard to a temp file and renames it over the
+// shard. Called with the shard's lock held, so no writer changes the file
+// meanwhile.
+static bool compact_db(Shard* shard) {
+    FILE* file = fopen(shard->path, "r");
+    if (!file) return false;
+    FILE* temp = fopen(shard->temp_path, "w");
+    if (!temp) {
+        fclose(file);
+        return false;
+    }
+    char line[MAX_LINE_LEN];
+    long live = 0;
+    bool ok = true;
+    lock_file(file, false); // Keeps out writers in other processes, not readers
+    while (ok && fgets(line, sizeof(line), file)) {
+        if (line[0] == TOMBSTONE_MARK) continue;
+        ok = fputs(line, temp) != EOF;
+        live++;
+    }
+    ok = fflush(temp) == 0 && fsync(fileno(temp)) == 0 && ok;
+    fclose(temp);
+    ok = ok && rename(shard->temp_path, shard->path) == 0;
+    unlock_file(file);
+    fclose(file);
+    if (!ok) {
+        perror("compact_db: compaction failed");
+        remove(shard->temp_path);
+        return false;
+    }
+    printf("Compacted %s: dropped %ld closed accounts, %ld remain\n", shard->path, shard->dead_records, live);
+    shard->live_records = live;
+    shard->dead_records = 0;
+    return true;
+}
+
+// Refills the account filter with every live account in the shards. Called
+// with every shard lock held (or before any request thread starts), so no
+// account is opened or closed meanwhile.
+static bool rebuild_filter(void) {
+    long live_records = 0;
+    for (int i = 0; i < DB_SHARDS; ++i) live_records += shards[i].live_records;
+    if (!acct_filter_rebuild_begin((size_t)live_records)) return false;
+    char line[MAX_LINE_LEN], acct[MAX_ACCT_LEN];
+    for (int i = 0; i < DB_SHARDS; ++i) {
+        FILE* file = fopen(shards[i].path, "r");
+        if (!file && errno != ENOENT) {
+            perror("rebuild_filter: cannot open database");
+            return false; // Lookups keep answering "maybe" until a retry succeeds
         }
+        if (!file) continue;
+        while (fgets(line, sizeof(line), file)) {
+            if (line[0] != TOMBSTONE_MARK && sscanf(line, "%15s", acct) == 1) acct_filter_add(acct);
+        }
+        fclose(file);
     }
-    fclose(db);
-    if (!found) return false;
-    if (balance - amount < 1000) return false;
-    if (!update_balance(account_no, balance - amount)) return false;
-    log_transaction(account_no, "WITHDRAW", amount, balance - amount);
+    acct_filter_rebuild_end();
     return true;
 }
 
+static void report_stats(void) {
+    AcctFilterStats st;
+    acct_filter_stats(&st);
+    unsigned long passed = st.lookups - st.rejected - st.bypassed;
+    printf("Account filter: %zu/%zu slots, %lu lookups, %lu rejected, %lu bypassed, %lu false positives (%.3f%% of passed)\n",
+           st.entries, st.capacity, st.lookups, st.rejected, st.bypassed, st.false_positives,
+           passed ? 100.0 * (double)st.false_positives / (double)passed : 0.0);
+    AcctCacheStats cs;
+    acct_cache_stats(&cs);
+    unsigned long gets = cs.hits + cs.misses;
+    printf("Account cache: %zu/%zu entries (%zu bytes), %lu hits, %lu misses (%.1f%% hit rate)\n",
+           cs.entries, cs.capacity, cs.bytes, cs.hits, cs.misses,
+           gets ? 100.0 * (double)cs.hits / (double)gets : 0.0);
+    fflush(stdout);
+}
+
+static void* compactor_main(void* arg) {
+    (void)arg;
+    time_t next_report = time(NULL) + STATS_REPORT_SEC;
+    for (;;) {
+        pthread_mutex_lock(&compact_lock);
+        struct timespec deadline = { .tv_sec = next_report, .tv_nsec = 0 };
+        while (!compact_requested && time(NULL) < next_report) {
+            pthread_cond_timedwait(&compact_cond, &compact_lock, &deadline);
+        }
+        compact_requested = false;
+        pthread_mutex_unlock(&compact_lock);
+
+        if (time(NULL) >= next_report) {
+            report_stats();
+            next_report = time(NULL) + STATS_REPORT_SEC;
+        }
+        bool ok = true;
+        if (acct_filter_needs_rebuild()) {
+            lock_all_shards();
+            ok = rebuild_filter();
+            unlock_all_shards();
+        }
+        // One shard at a time; requests to the others carry on
+        for (int i = 0; ok && i < DB_SHARDS; ++i) {
+            pthread_mutex_lock(&shards[i].lock);
+            if (compaction_due(&shards[i])) ok = compact_db(&shards[i]);
+            pthread_mutex_unlock(&shards[i].lock);
+        }
+        if (!ok) {
+            sleep(COMPACT_RETRY_SEC);
+            wake_compactor(); // Try again
+        }
+    }
+    return NULL;
+}
+
+// Withdraws, leaving at least 1k, in units of >= 500
+bool withdraw_extended(const char* account_no, const char* pin, double amount) {
+    if (amount < 500) return false;
+    if (!check_pin(account_no, pin)) return false;
+    double balance;
+    return apply_delta(account_no, -amount, 1000, true, &balance) == DELTA_OK;
+}
+
 // Deposit at least 500
 bool deposit_extended(const char* account_no, const char* pin, double amount) {
     if (amount < 500) return false;
-    FILE* db = fopen(DB_FILENAME, "r");
-    if (!db) return false;
-    char line[MAX_LINE_LEN], file_acct[MAX_ACCT_LEN], file_pin[8], name[64], national_id[32], account_type[16];
-    double balance = 0;
-    bool found = false;
-    while (fgets(line, sizeof(line), db)) {
-        if (sscanf(line, "%s %s %s %s %s %lf", file_acct, file_pin, name, national_id, account_type, &balance) == 6) {
-            if (strcmp(file_acct, account_no) == 0 && strcmp(file_pin, pin) == 0) {
-                found = true;
-                break;
-            }
-        }
-    }
-    fclose(db);
-    if (!found) return false;
-    if (!update_balance(account_no, balance + amount)) return false;
-    log_transaction(account_no, "DEPOSIT", amount, balance + amount);
-    return true;
+    if (!check_pin(account_no, pin)) return false;
+    double balance;
+    return apply_delta(account_no, amount, 0, true, &balance) == DELTA_OK;
 }
 
 // Returns the balance in the account
 bool balance(const char* account_no, double* out_balance) {
-    FILE* file = fopen(DB_FILENAME, "r");
-    if (!file) return false;
-    char line[MAX_LINE_LEN], file_acct[MAX_ACCT_LEN];
-    double file_balance;
-    bool found = false;
-    while (fgets(line, sizeof(line), file)) {
-        // Skip to the 6th field (balance)
-        if (sscanf(line, "%s %*s %*s %*s %*s %lf", file_acct, &file_balance) == 2) {
-            if (strcmp(file_acct, account_no) == 0) {
-                *out_balance = file_balance;
-                found = true;
-                break;
-            }
-        }
-    }
-    fclose(file);
-    return found;
+    return get_balance(account_no, out_balance);
 }
 
 // Returns last five transactions (debit/credit) for the account
 bool statement(const char* account_no, const char* pin, char transactions[5][MAX_LINE_LEN]) {
-    FILE *db = fopen(DB_FILENAME, "r");
-    if (!db) return false;
-    char line[MAX_LINE_LEN], file_acct[MAX_ACCT_LEN], file_pin[8];
-    bool found = false;
-    while (fgets(line, sizeof(line), db))
-        if (sscanf(line, "%s %s", file_acct, file_pin) == 2 &&
-            !strcmp(file_acct, account_no) && !strcmp(file_pin, pin)) { found = true; break; }
-    fclose(db);
-    if (!found) return false;
-    char filename[64]; snprintf(filename, sizeof(filename), "%s.txt", account_no);
-    FILE *tf = fopen(filename, "r"); if (!tf) return false;
-    char all[5][MAX_LINE_LEN] = {{0}}; int count = 0;
-    while (fgets(line, sizeof(line), tf))
-        count < 5 ? strncpy(all[count++], line, MAX_LINE_LEN) :
-        (memmove(all, all+1, 4*MAX_LINE_LEN), strncpy(all[4], line, MAX_LINE_LEN));
-    fclose(tf);
-    for (int i = 0; i < 5; ++i) strncpy(transactions[i], all[i], MAX_LINE_LEN);
+    CachedAccount record;
+    if (!lookup_account(account_no, &record) || strcmp(record.pin, pin) != 0) return false;
+    // Fixed-size records: the last five are one pread at the end of the log
+    TxnRecord records[5];
+    int count = txn_log_tail(account_no, 5, records);
+    for (int i = 0; i < count; ++i) {
+        char timebuf[TXN_TIME_LEN];
+        txn_format_time(records[i].timestamp, timebuf);
+        snprintf(transactions[i], MAX_LINE_LEN, "%s %.2f %.2f %s\n", txn_op_name(records[i].op),
+                 records[i].amount_cents / 100.0, records[i].balance_cents / 100.0, timebuf);
+    }
     return count > 0;
 }
 
-void log_transaction(const char* account_no, const char* type, double amount, double balance) {
-    char filename[64]; snprintf(filename, sizeof(filename), "%s.txt", account_no);
-    FILE* file = fopen(filename, "a"); if (!file) return;
-    time_t now = time(NULL); char timebuf[32];
-    strftime(timebuf, sizeof(timebuf), "%Y-%m-%d %H:%M:%S", localtime(&now));
-    fprintf(file, "%s %.2f %.2f %s\n", type, amount, balance, timebuf);
-    fclose(file);
+void log_transaction(const char* account_no, TxnOp op, double amount, double balance) {
+    txn_log_append(account_no, op, amount, balance, NULL);
 }
 // File I/O Functions Implementation
 
@@ -656,18 +924,6 @@ static void unlock_file(FILE* file) {
 }
 
 bool check_pin(const char* account_no, const char* pin) {
-    FILE* file = fopen(DB_FILENAME, "r");
-    if (!file) return false;
-    char line[MAX_LINE_LEN], file_acct[MAX_ACCT_LEN], file_pin[8];
-    bool found = false;
-    while (fgets(line, sizeof(line), file)) {
-        if (sscanf(line, "%s %s", file_acct, file_pin) == 2 &&
-            strcmp(file_acct, account_no) == 0 &&
-            strcmp(file_pin, pin) == 0) {
-            found = true;
-            break;
-        }
-    }
-    fclose(file);
-    return found;
-}
\ No newline at end of file
+    CachedAccount record;
+    return lookup_account(account_no, &record) && strcmp(record.pin, pin) == 0;
+}
@@ -0,0 +1,241 @@
+#define _GNU_SOURCE // For pread, flock
+#include "txn_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#define TXN_PATH_LEN 64
+
+static const char* op_names[] = { "UNKNOWN", "OPEN_ACCOUNT", "DEPOSIT", "WITHDRAW", "CLOSE_ACCOUNT" };
+#define OP_COUNT (sizeof(op_names) / sizeof(op_names[0]))
+
+int64_t txn_to_cents(double amount) {
+    return (int64_t)(amount * 100.0 + (amount < 0 ? -0.5 : 0.5));
+}
+
+// Records keep whole seconds, so the coarse clock (the last tick, no
+// hardware counter read) is precise enough
+static int64_t txn_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    return (int64_t)ts.tv_sec;
+}
+
+const char* txn_op_name(uint8_t op) {
+    return op < OP_COUNT ? op_names[op] : op_names[0];
+}
+
+uint8_t txn_op_from_name(const char* name) {
+    for (uint8_t op = 1; op < OP_COUNT; ++op) {
+        if (strcmp(op_names[op], name) == 0) return op;
+    }
+    return 0;
+}
+
+// Prints cents as "-12.34" without going through double
+static int format_cents(char* out, size_t len, int64_t cents) {
+    uint64_t abs_cents = cents < 0 ? (uint64_t)0 - (uint64_t)cents : (uint64_t)cents;
+    return snprintf(out, len, "%s%llu.%02llu", cents < 0 ? "-" : "",
+                    (unsigned long long)(abs_cents / 100), (unsigned long long)(abs_cents % 100));
+}
+
+// Per-thread "YYYY-MM-DD HH:MM:" of the last minute formatted. Zone offsets
+// and DST switches fall on whole minutes, so within one minute only the
+// seconds differ.
+static _Thread_local int64_t cached_minute = INT64_MIN;
+static _Thread_local char cached_prefix[TXN_TIME_LEN];
+static _Thread_local size_t cached_prefix_len = 0;
+
+void txn_format_time(int64_t timestamp, char* out) {
+    int64_t second = timestamp % 60;
+    if (second < 0) second += 60;
+    int64_t minute = timestamp - second;
+    if (minute != cached_minute) {
+        time_t when = (time_t)minute;
+        struct tm tm_buf;
+        cached_prefix_len = strftime(cached_prefix, sizeof(cached_prefix) - 2, "%Y-%m-%d %H:%M:",
+                                     localtime_r(&when, &tm_buf));
+        cached_minute = minute;
+    }
+    memcpy(out, cached_prefix, cached_prefix_len);
+    out[cached_prefix_len] = (char)('0' + second / 10);
+    out[cached_prefix_len + 1] = (char)('0' + second % 10);
+    out[cached_prefix_len + 2] = '\0';
+}
+
+void txn_record_render(const TxnRecord* rec, char* out, size_t out_len) {
+    char time_buffer[TXN_TIME_LEN], amount[32], balance[32];
+    txn_format_time(rec->timestamp, time_buffer);
+    format_cents(amount, sizeof(amount), rec->amount_cents);
+    format_cents(balance, sizeof(balance), rec->balance_cents);
+    snprintf(out, out_len, "%s: %s, Amt: %s, Bal: %s", time_buffer, txn_op_name(rec->op), amount, balance);
+}
+
+static void log_path(char* out, const char* account_no, const char* suffix) {
+    snprintf(out, TXN_PATH_LEN, "%s%s", account_no, suffix);
+}
+
+// Parses one line of any text log format older servers wrote:
+//   3_4_3:        "2025-06-05 20:21:34: DEPOSIT, Amt: 500.00, Bal: 1500.00"
+//   3_4_1, 3_4_4: "DEPOSIT 500.00 1500.00 2025-06-05 20:21:34"
+static bool parse_text_line(const char* line, TxnRecord* rec) {
+    struct tm tm_buf;
+    memset(&tm_buf, 0, sizeof(tm_buf));
+    char type[32];
+    double amount, balance;
+
+    if (sscanf(line, "%d-%d-%d %d:%d:%d: %31[^,], Amt: %lf, Bal: %lf",
+               &tm_buf.tm_year, &tm_buf.tm_mon, &tm_buf.tm_mday,
+               &tm_buf.tm_hour, &tm_buf.tm_min, &tm_buf.tm_sec, type, &amount, &balance) != 9 &&
+        sscanf(line, "%31s %lf %lf %d-%d-%d %d:%d:%d", type, &amount, &balance,
+               &tm_buf.tm_year, &tm_buf.tm_mon, &tm_buf.tm_mday,
+               &tm_buf.tm_hour, &tm_buf.tm_min, &tm_buf.tm_sec) != 9) {
+        return false;
+    }
+    uint8_t op = txn_op_from_name(type);
+    if (op == 0) return false;
+
+    tm_buf.tm_year -= 1900;
+    tm_buf.tm_mon -= 1;
+    tm_buf.tm_isdst = -1;
+    memset(rec, 0, sizeof(*rec));
+    rec->timestamp = (int64_t)mktime(&tm_buf);
+    rec->amount_cents = txn_to_cents(amount);
+    rec->balance_cents = txn_to_cents(balance);
+    rec->op = op;
+    return true;
+}
+
+// Appends the records of a text log to fd, numbering them from first_seq
+static bool import_into(const char* txt_filename, int fd, uint32_t first_seq, size_t* out_records) {
+    FILE* in = fopen(txt_filename, "r");
+    if (!in) return false;
+
+    char line[512];
+    TxnRecord rec;
+    uint32_t seq = first_seq;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), in)) {
+        if (!parse_text_line(line, &rec)) continue;
+        rec.seq = seq++;
+        ok = write(fd, &rec, sizeof(rec)) == (ssize_t)sizeof(rec);
+    }
+    fclose(in);
+    if (!ok) perror("txn_log: import write failed");
+    if (out_records) *out_records = seq - first_seq;
+    return ok;
+}
+
+bool txn_log_import_text(const char* txt_filename, const char* log_filename, size_t* out_records) {
+    int fd = open(log_filename, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd == -1) {
+        perror("txn_log_import_text: cannot create binary log");
+        return false;
+    }
+    bool ok = import_into(txt_filename, fd, 0, out_records) && fsync(fd) == 0;
+    close(fd);
+    if (!ok) remove(log_filename);
+    return ok;
+}
+
+// Opens the account's log locked exclusively, converting a leftover text
+// log first. Returns -1 (errno ENOENT) if there is no log and !create.
+static int open_log(const char* account_no, bool create) {
+    char path[TXN_PATH_LEN], txt_path[TXN_PATH_LEN];
+    log_path(path, account_no, ".log");
+    log_path(txt_path, account_no, ".txt");
+
+    int fd = open(path, O_RDWR | O_APPEND | (create ? O_CREAT : 0), 0644);
+    if (fd == -1 && errno == ENOENT && access(txt_path, F_OK) == 0) {
+        fd = open(path, O_RDWR | O_APPEND | O_CREAT, 0644);
+    }
+    if (fd == -1) return -1;
+    flock(fd, LOCK_EX);
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size == 0 && access(txt_path, F_OK) == 0) {
+        size_t imported = 0;
+        if (import_into(txt_path, fd, 0, &imported) && fsync(fd) == 0) {
+            remove(txt_path);
+        } else if (ftruncate(fd, 0) == -1) { // Retry the conversion next time
+            perror("txn_log: ftruncate failed");
+        }
+    }
+    return fd;
+}
+
+// Records in the log; a torn record at the end (crash mid-write) is cut off
+static uint32_t record_count(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) == -1) return 0;
+    off_t whole = st.st_size - st.st_size % (off_t)sizeof(TxnRecord);
+    if (whole != st.st_size && ftruncate(fd, whole) == -1) perror("txn_log: ftruncate failed");
+    return (uint32_t)(whole / (off_t)sizeof(TxnRecord));
+}
+
+bool txn_log_append(const char* account_no, uint8_t op, double amount, double balance_after, TxnRecord* out) {
+    int fd = open_log(account_no, true);
+    if (fd == -1) {
+        perror("txn_log_append: Error opening transaction log file");
+        return false;
+    }
+
+    TxnRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.timestamp = txn_now();
+    rec.amount_cents = txn_to_cents(amount);
+    rec.balance_cents = txn_to_cents(balance_after);
+    rec.seq = record_count(fd);
+    rec.op = op;
+
+    bool ok = write(fd, &rec, sizeof(rec)) == (ssize_t)sizeof(rec);
+    if (!ok) perror("txn_log_append: write failed");
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    if (ok && out) *out = rec;
+    return ok;
+}
+
+int txn_log_tail(const char* account_no, int max_records, TxnRecord* out) {
+    if (max_records > TXN_TAIL_MAX) max_records = TXN_TAIL_MAX;
+    if (max_records <= 0) return 0;
+
+    int fd = open_log(account_no, false);
+    if (fd == -1) {
+        if (errno == ENOENT) return 0; // No transactions logged yet
+        perror("txn_log_tail: Error opening transaction log file");
+        return -1;
+    }
+    flock(fd, LOCK_SH); // Conversion (if any) is done; readers can share
+
+    struct stat st;
+    int count = -1;
+    if (fstat(fd, &st) == 0) {
+        long total = (long)(st.st_size / (off_t)sizeof(TxnRecord));
+        count = total < max_records ? (int)total : max_records;
+        size_t bytes = (size_t)count * sizeof(TxnRecord);
+        off_t offset = (off_t)(total - count) * (off_t)sizeof(TxnRecord);
+        if (pread(fd, out, bytes, offset) != (ssize_t)bytes) {
+            perror("txn_log_tail: pread failed");
+            count = -1;
+        }
+    }
+    flock(fd, LOCK_UN);
+    close(fd);
+    return count;
+}
+
+bool txn_log_remove(const char* account_no) {
+    char path[TXN_PATH_LEN], txt_path[TXN_PATH_LEN];
+    log_path(path, account_no, ".log");
+    log_path(txt_path, account_no, ".txt");
+    remove(txt_path);
+    return remove(path) == 0 || errno == ENOENT;
+}
@@ -0,0 +1,27 @@
+#ifndef ACCOUNT_HASH_H
+#define ACCOUNT_HASH_H
+
+#include "common.h"
+#include <stdint.h>
+
+// Hashing for the account store, the txn ring and the txn log index
+
+#define FNV1A_INIT 2166136261u
+#define FNV1A_PRIME 16777619u
+
+// FNV-1a over s up to its NUL or max bytes, whichever comes first: record
+// fields are fixed-size and need not be terminated
+static inline uint32_t fnv1a_bounded(const char* s, size_t max) {
+    uint32_t h = FNV1A_INIT;
+    for (size_t i = 0; i < max && s[i]; ++i) {
+        h ^= (unsigned char)s[i];
+        h *= FNV1A_PRIME;
+    }
+    return h;
+}
+
+static inline uint32_t hash_account_no(const char* account_no) {
+    return fnv1a_bounded(account_no, MAX_ACCT_LEN);
+}
+
+#endif // ACCOUNT_HASH_H
@@ -0,0 +1,566 @@
+#define _GNU_SOURCE // For mremap
+#include "account_store.h"
+#include "account_hash.h"
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SLOT_EMPTY   -1
+#define SLOT_DELETED -2
+#define INITIAL_CAPACITY 1024 // Records allocated / hash slots, always a power of two
+#define LOCK_STRIPES 64        // Power of two; accounts sharing a stripe serialize
+#define STORE_PATH_LEN 256
+
+typedef struct {
+    char account_no[MAX_ACCT_LEN]; // "" marks a free record
+    int64_t balance_cents;
+    uint32_t pin_hash;
+    uint32_t version;              // Bumped by every write of the record
+} HotAccount;
+
+_Static_assert(sizeof(HotAccount) == 32, "record size is part of the file format");
+
+// account_type is dictionary-encoded; a type outside the dictionary is
+// stored as ACCOUNT_TYPE_NONE and read back as ""
+typedef enum {
+    ACCOUNT_TYPE_NONE,
+    ACCOUNT_TYPE_SAVINGS,
+    ACCOUNT_TYPE_CHECKING
+} AccountType;
+
+static const char* account_type_names[] = { "", "savings", "checking" };
+#define ACCOUNT_TYPE_COUNT (sizeof(account_type_names) / sizeof(account_type_names[0]))
+
+typedef struct {
+    char pin[8];
+    char name[64];
+    char national_id[32];
+    uint8_t account_type; // AccountType
+    uint8_t reserved[7];
+} ColdAccount;
+
+_Static_assert(sizeof(ColdAccount) == 112, "record size is part of the file format");
+
+static pthread_rwlock_t store_lock = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_rwlock_t stripe_locks[LOCK_STRIPES];
+static pthread_once_t stripes_once = PTHREAD_ONCE_INIT;
+
+static int hot_fd = -1;
+static int cold_fd = -1;
+static HotAccount* hot = NULL;     // Anonymous mapping, so page (and cache line) aligned
+static size_t hot_capacity = 0;    // Records covered by the mapping
+static size_t account_count = 0;   // Records actually in the files, live or free
+
+// Records freed by store_delete, reused by store_add before the files grow.
+// A free record is all zeroes on disk, so the list is rebuilt by the scan
+// store_open already makes to build the hash.
+static int32_t* free_records = NULL;
+static size_t free_count = 0;
+static size_t free_capacity = 0;
+
+static int32_t* slots = NULL;      // Open addressing table of record numbers
+static size_t slot_capacity = 0;
+static size_t slot_used = 0;       // Live + deleted slots, drives resizing
+
+// FNV-1a over the PIN; lets a wrong PIN be rejected from the hot record alone
+static uint32_t hash_pin(const char* pin) {
+    return fnv1a_bounded(pin, sizeof(((ColdAccount*)0)->pin));
+}
+
+static int64_t to_cents(double amount) {
+    return (int64_t)(amount * 100.0 + (amount < 0 ? -0.5 : 0.5));
+}
+
+static uint8_t account_type_code(const char* name, size_t len) {
+    for (uint8_t t = 1; t < ACCOUNT_TYPE_COUNT; ++t) {
+        if (strncmp(account_type_names[t], name, len) == 0) return t;
+    }
+    return ACCOUNT_TYPE_NONE;
+}
+
+// Copies a fixed-size field that may lack its terminator
+static void copy_field(char* out, const char* in, size_t size) {
+    memcpy(out, in, size);
+    out[size - 1] = '\0';
+}
+
+static void split_account(const Account* account, HotAccount* h, ColdAccount* c) {
+    memset(h, 0, sizeof(*h));
+    memset(c, 0, sizeof(*c));
+    copy_field(h->account_no, account->account_no, sizeof(h->account_no));
+    h->balance_cents = to_cents(account->balance);
+    copy_field(c->pin, account->pin, sizeof(c->pin));
+    h->pin_hash = hash_pin(c->pin);
+    copy_field(c->name, account->name, sizeof(c->name));
+    copy_field(c->national_id, account->national_id, sizeof(c->national_id));
+    c->account_type = account_type_code(account->account_type, sizeof(account->account_type));
+}
+
+static void join_account(const HotAccount* h, const ColdAccount* c, Account* out) {
+    memset(out, 0, sizeof(*out));
+    memcpy(out->account_no, h->account_no, sizeof(out->account_no));
+    memcpy(out->pin, c->pin, sizeof(out->pin));
+    memcpy(out->name, c->name, sizeof(out->name));
+    memcpy(out->national_id, c->national_id, sizeof(out->national_id));
+    const char* type = c->account_type < ACCOUNT_TYPE_COUNT ? account_type_names[c->account_type] : "";
+    snprintf(out->account_type, sizeof(out->account_type), "%s", type);
+    out->balance = (double)h->balance_cents / 100.0;
+}
+
+static void init_stripes(void) {
+    for (int i = 0; i < LOCK_STRIPES; ++i) pthread_rwlock_init(&stripe_locks[i], NULL);
+}
+
+static pthread_rwlock_t* stripe_for(uint32_t hash) {
+    return &stripe_locks[hash & (LOCK_STRIPES - 1)];
+}
+
+// Returns the hash slot holding account_no, or -(free slot + 1) if absent
+static long probe_hashed(const char* account_no, uint32_t hash) {
+    size_t mask = slot_capacity - 1;
+    size_t i = hash & mask;
+    long first_free = -1;
+
+    for (size_t n = 0; n < slot_capacity; ++n, i = (i + 1) & mask) {
+        int32_t s = slots[i];
+        if (s == SLOT_EMPTY) {
+            return -((first_free >= 0 ? first_free : (long)i) + 1);
+        }
+        if (s == SLOT_DELETED) {
+            if (first_free < 0) first_free = (long)i;
+            continue;
+        }
+        if (strncmp(hot[s].account_no, account_no, MAX_ACCT_LEN) == 0) {
+            return (long)i;
+        }
+    }
+    return -(first_free + 1); // Load factor keeps at least one empty slot
+}
+
+static long probe(const char* account_no) {
+    return probe_hashed(account_no, hash_account_no(account_no));
+}
+
+static bool rehash(size_t new_capacity) {
+    int32_t* new_slots = malloc(new_capacity * sizeof(int32_t));
+    if (!new_slots) {
+        perror("store rehash: malloc failed");
+        return false;
+    }
+    for (size_t i = 0; i < new_capacity; ++i) new_slots[i] = SLOT_EMPTY;
+
+    free(slots);
+    slots = new_slots;
+    slot_capacity = new_capacity;
+    slot_used = 0;
+
+    for (size_t r = 0; r < account_count; ++r) {
+        if (hot[r].account_no[0] == '\0') continue; // Free record
+        long pos = probe(hot[r].account_no);
+        if (pos >= 0) {
+            fprintf(stderr, "store: duplicate account %.*s, keeping the first\n",
+                    MAX_ACCT_LEN, hot[r].account_no);
+            continue;
+        }
+        slots[-pos - 1] = (int32_t)r;
+        slot_used++;
+    }
+    return true;
+}
+
+static bool push_free(size_t record) {
+    if (free_count == free_capacity) {
+        size_t new_capacity = free_capacity ? free_capacity * 2 : 64;
+        int32_t* grown = realloc(free_records, new_capacity * sizeof(int32_t));
+        if (!grown) {
+            perror("store: realloc failed");
+            return false;
+        }
+        free_records = grown;
+        free_capacity = new_capacity;
+    }
+    free_records[free_count++] = (int32_t)record;
+    return true;
+}
+
+// Makes sure the hot array has room for at least `needed` records
+static bool ensure_capacity(size_t needed) {
+    if (needed <= hot_capacity) return true;
+
+    size_t new_capacity = hot_capacity ? hot_capacity : INITIAL_CAPACITY;
+    while (new_capacity < needed) new_capacity *= 2;
+
+    void* map;
+    if (hot) {
+        map = mremap(hot, hot_capacity * sizeof(HotAccount), new_capacity * sizeof(HotAccount), MREMAP_MAYMOVE);
+    } else {
+        map = mmap(NULL, new_capacity * sizeof(HotAccount), PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (map == MAP_FAILED) {
+        perror("store: mmap failed");
+        return false;
+    }
+    hot = map;
+    hot_capacity = new_capacity;
+    return true;
+}
+
+static bool flush_file(FILE* file) {
+    return fflush(file) == 0 && fsync(fileno(file)) == 0;
+}
+
+// Splits a legacy file of whole Account records into the hot and cold files,
+// dropping free records; without one, both files start empty. The cold file
+// is renamed into place first, so an existing hot file always has its cold
+// records.
+static bool import_legacy(const char* legacy_filename, const char* hot_filename, const char* cold_filename) {
+    char hot_temp[STORE_PATH_LEN], cold_temp[STORE_PATH_LEN];
+    snprintf(hot_temp, sizeof(hot_temp), "%s.tmp", hot_filename);
+    snprintf(cold_temp, sizeof(cold_temp), "%s.tmp", cold_filename);
+
+    FILE* in = fopen(legacy_filename, "rb");
+    if (!in && errno != ENOENT) {
+        perror("store_open: cannot read the legacy account file");
+        return false;
+    }
+    FILE* hot_out = fopen(hot_temp, "wb");
+    FILE* cold_out = fopen(cold_temp, "wb");
+    bool ok = hot_out && cold_out;
+
+    Account account;
+    HotAccount h;
+    ColdAccount c;
+    size_t imported = 0;
+    while (ok && in && fread(&account, sizeof(account), 1, in) == 1) {
+        if (account.account_no[0] == '\0') continue; // Free record
+        split_account(&account, &h, &c);
+        ok = fwrite(&h, sizeof(h), 1, hot_out) == 1 && fwrite(&c, sizeof(c), 1, cold_out) == 1;
+        imported++;
+    }
+    ok = ok && !(in && ferror(in)) && flush_file(hot_out) && flush_file(cold_out);
+    if (in) fclose(in);
+    if (hot_out) fclose(hot_out);
+    if (cold_out) fclose(cold_out);
+    ok = ok && rename(cold_temp, cold_filename) == 0 && rename(hot_temp, hot_filename) == 0;
+    if (!ok) {
+        perror("store_open: cannot split the legacy account file");
+        remove(hot_temp);
+        remove(cold_temp);
+        return false;
+    }
+    if (in) printf("Split %zu accounts from %s into %s and %s\n", imported, legacy_filename, hot_filename, cold_filename);
+    return true;
+}
+
+bool store_open(const char* hot_filename, const char* cold_filename, const char* legacy_filename) {
+    pthread_once(&stripes_once, init_stripes);
+
+    hot_fd = open(hot_filename, O_RDWR);
+    if (hot_fd == -1 && errno == ENOENT && import_legacy(legacy_filename, hot_filename, cold_filename)) {
+        hot_fd = open(hot_filename, O_RDWR);
+    }
+    if (hot_fd == -1) {
+        perror("store_open: open failed");
+        return false;
+    }
+    cold_fd = open(cold_filename, O_RDWR | O_CREAT, 0644);
+    if (cold_fd == -1) {
+        perror("store_open: open failed");
+        store_close();
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(hot_fd, &st) == -1) {
+        perror("store_open: fstat failed");
+        store_close();
+        return false;
+    }
+    account_count = (size_t)st.st_size / sizeof(HotAccount);
+    if ((size_t)st.st_size % sizeof(HotAccount) != 0) {
+        fprintf(stderr, "store_open: ignoring %zu trailing bytes in %s\n",
+                (size_t)st.st_size % sizeof(HotAccount), hot_filename);
+    }
+
+    size_t hash_capacity = INITIAL_CAPACITY;
+    while (account_count * 10 >= hash_capacity * 7) hash_capacity *= 2;
+    if (!ensure_capacity(account_count > 0 ? account_count : 1)) {
+        store_close();
+        return false;
+    }
+    size_t bytes = account_count * sizeof(HotAccount);
+    for (size_t done = 0; done < bytes;) {
+        ssize_t n = pread(hot_fd, (char*)hot + done, bytes - done, (off_t)done);
+        if (n <= 0) {
+            perror("store_open: read failed");
+            store_close();
+            return false;
+        }
+        done += (size_t)n;
+    }
+    if (!rehash(hash_capacity)) {
+        store_close();
+        return false;
+    }
+    // Pushed in reverse so the lowest free record is reused first
+    for (size_t r = account_count; r-- > 0;) {
+        if (hot[r].account_no[0] == '\0' && !push_free(r)) {
+            store_close();
+            return false;
+        }
+    }
+
+    printf("Loaded %zu accounts from %s (%zu free records, %zu KB in memory)\n", account_count - free_count,
+           hot_filename, free_count, (account_count * sizeof(HotAccount) + slot_capacity * sizeof(int32_t)) / 1024);
+    return true;
+}
+
+void store_close(void) {
+    pthread_rwlock_wrlock(&store_lock);
+    if (hot) munmap(hot, hot_capacity * sizeof(HotAccount));
+    if (hot_fd != -1) close(hot_fd);
+    if (cold_fd != -1) close(cold_fd);
+    free(slots);
+    free(free_records);
+    hot = NULL;
+    slots = NULL;
+    free_records = NULL;
+    free_count = free_capacity = 0;
+    hot_fd = cold_fd = -1;
+    hot_capacity = account_count = 0;
+    slot_capacity = slot_used = 0;
+    pthread_rwlock_unlock(&store_lock);
+}
+
+bool store_exists(const char* account_no) {
+    pthread_rwlock_rdlock(&store_lock);
+    bool found = slots && probe(account_no) >= 0;
+    pthread_rwlock_unlock(&store_lock);
+    return found;
+}
+
+static bool write_hot(size_t record, const HotAccount* h) {
+    off_t offset = (off_t)record * (off_t)sizeof(HotAccount);
+    if (pwrite(hot_fd, h, sizeof(HotAccount), offset) != (ssize_t)sizeof(HotAccount)) {
+        perror("store: pwrite failed");
+        return false;
+    }
+    return true;
+}
+
+static bool write_cold(size_t record, const ColdAccount* c) {
+    off_t offset = (off_t)record * (off_t)sizeof(ColdAccount);
+    if (pwrite(cold_fd, c, sizeof(ColdAccount), offset) != (ssize_t)sizeof(ColdAccount)) {
+        perror("store: pwrite failed");
+        return false;
+    }
+    return true;
+}
+
+// Publishes a rewritten record to the lock-free readers, which load only
+// balance_cents and pin_hash. Called with the record's stripe lock held.
+static void set_hot(size_t record, const HotAccount* h) {
+    __atomic_store_n(&hot[record].balance_cents, h->balance_cents, __ATOMIC_RELAXED);
+    __atomic_store_n(&hot[record].pin_hash, h->pin_hash, __ATOMIC_RELAXED);
+    hot[record].version = h->version;
+}
+
+bool store_get(const char* account_no, Account* out) {
+    bool found = false;
+    uint32_t hash = hash_account_no(account_no);
+    pthread_rwlock_rdlock(&store_lock);
+    if (slots) {
+        long pos = probe_hashed(account_no, hash);
+        if (pos >= 0) {
+            size_t record = (size_t)slots[pos];
+            ColdAccount c;
+            // Stripe lock so the two halves come from the same write
+            pthread_rwlock_rdlock(stripe_for(hash));
+            HotAccount h = hot[record];
+            off_t offset = (off_t)record * (off_t)sizeof(ColdAccount);
+            found = pread(cold_fd, &c, sizeof(c), offset) == (ssize_t)sizeof(c);
+            pthread_rwlock_unlock(stripe_for(hash));
+            if (found) {
+                join_account(&h, &c, out);
+            } else {
+                perror("store_get: pread failed");
+            }
+        }
+    }
+    pthread_rwlock_unlock(&store_lock);
+    return found;
+}
+
+bool store_get_balance(const char* account_no, double* out) {
+    bool found = false;
+    pthread_rwlock_rdlock(&store_lock);
+    if (slots) {
+        long pos = probe(account_no);
+        if (pos >= 0) {
+            *out = (double)__atomic_load_n(&hot[slots[pos]].balance_cents, __ATOMIC_RELAXED) / 100.0;
+            found = true;
+        }
+    }
+    pthread_rwlock_unlock(&store_lock);
+    return found;
+}
+
+// The hot hash only rejects fast: a 32-bit FNV value is easy to collide, so
+// a match is confirmed against the PIN in the cold record
+bool store_check_pin(const char* account_no, const char* pin) {
+    bool match = false;
+    uint32_t hash = hash_account_no(account_no);
+    pthread_rwlock_rdlock(&store_lock);
+    if (slots) {
+        long pos = probe_hashed(account_no, hash);
+        if (pos >= 0 && __atomic_load_n(&hot[slots[pos]].pin_hash, __ATOMIC_RELAXED) == hash_pin(pin)) {
+            size_t record = (size_t)slots[pos];
+            ColdAccount c;
+            pthread_rwlock_rdlock(stripe_for(hash));
+            off_t offset = (off_t)record * (off_t)sizeof(ColdAccount);
+            bool read_ok = pread(cold_fd, &c, sizeof(c), offset) == (ssize_t)sizeof(c);
+            pthread_rwlock_unlock(stripe_for(hash));
+            if (read_ok) {
+                c.pin[sizeof(c.pin) - 1] = '\0';
+                match = strcmp(c.pin, pin) == 0;
+            } else {
+                perror("store_check_pin: pread failed");
+            }
+        }
+    }
+    pthread_rwlock_unlock(&store_lock);
+    return match;
+}
+
+bool store_update(const Account* account) {
+    bool ok = false;
+    uint32_t hash = hash_account_no(account->account_no);
+    // Shared structural lock is enough: the slot layout does not change, and
+    // each half is a single pwrite of one record
+    pthread_rwlock_rdlock(&store_lock);
+    if (slots) {
+        long pos = probe_hashed(account->account_no, hash);
+        if (pos >= 0) {
+            size_t record = (size_t)slots[pos];
+            HotAccount h;
+            ColdAccount c;
+            split_account(account, &h, &c);
+
+            pthread_rwlock_wrlock(stripe_for(hash));
+            h.version = hot[record].version + 1;
+            ok = write_cold(record, &c) && write_hot(record, &h);
+            if (ok) set_hot(record, &h);
+            pthread_rwlock_unlock(stripe_for(hash));
+        }
+    }
+    pthread_rwlock_unlock(&store_lock);
+    return ok;
+}
+
+StoreStatus store_apply_delta(const char* account_no, double delta, double min_balance, double* out_balance,
+                              store_commit_fn on_commit, void* arg) {
+    StoreStatus status = STORE_NOT_FOUND;
+    uint32_t hash = hash_account_no(account_no);
+    int64_t delta_cents = to_cents(delta);
+
+    pthread_rwlock_rdlock(&store_lock);
+    if (slots) {
+        long pos = probe_hashed(account_no, hash);
+        if (pos >= 0) {
+            size_t record = (size_t)slots[pos];
+
+            // Read, check and write back under one exclusive stripe lock;
+            // the cold record is not touched
+            pthread_rwlock_wrlock(stripe_for(hash));
+            HotAccount updated = hot[record];
+            if (delta_cents < 0 && updated.balance_cents + delta_cents < to_cents(min_balance)) {
+                status = STORE_INSUFFICIENT_FUNDS;
+            } else {
+                updated.balance_cents += delta_cents;
+                updated.version++;
+                status = write_hot(record, &updated) ? STORE_OK : STORE_IO_ERROR;
+                if (status == STORE_OK) {
+                    set_hot(record, &updated);
+                    if (on_commit) on_commit(account_no, (double)updated.balance_cents / 100.0, arg);
+                }
+            }
+            pthread_rwlock_unlock(stripe_for(hash));
+
+            if (out_balance) *out_balance = (double)updated.balance_cents / 100.0;
+        }
+    }
+    pthread_rwlock_unlock(&store_lock);
+    return status;
+}
+
+bool store_add(const Account* account) {
+    bool ok = false;
+    pthread_rwlock_wrlock(&store_lock);
+    if (!slots) goto out;
+
+    long pos = probe(account->account_no);
+    if (pos >= 0) goto out; // Already registered
+
+    if ((slot_used + 1) * 10 > slot_capacity * 7) {
+        // slot_used counts tombstones too. Grow only when the live accounts
+        // alone fill half the table; otherwise delete churn would double it
+        // forever, so clear the tombstones at the same size instead.
+        size_t live = account_count - free_count;
+        size_t new_capacity = (live + 1) * 2 > slot_capacity ? slot_capacity * 2 : slot_capacity;
+        if (!rehash(new_capacity)) goto out;
+        pos = probe(account->account_no);
+    }
+    // Reuse a freed record before growing the files
+    size_t record = free_count > 0 ? (size_t)free_records[free_count - 1] : account_count;
+    if (record == account_count && !ensure_capacity(account_count + 1)) goto out;
+
+    HotAccount h;
+    ColdAccount c;
+    split_account(account, &h, &c);
+    // The hot record makes the account exist, so it is written last
+    if (!write_cold(record, &c) || !write_hot(record, &h)) goto out;
+    hot[record] = h;
+
+    if (record == account_count) {
+        account_count++;
+    } else {
+        free_count--;
+    }
+    size_t slot = (size_t)(-pos - 1);
+    if (slots[slot] == SLOT_EMPTY) slot_used++;
+    slots[slot] = (int32_t)record;
+    ok = true;
+out:
+    pthread_rwlock_unlock(&store_lock);
+    return ok;
+}
+
+bool store_delete(const char* account_no) {
+    bool ok = false;
+    pthread_rwlock_wrlock(&store_lock);
+    if (!slots) goto out;
+
+    long pos = probe(account_no);
+    if (pos < 0) goto out;
+
+    // Zero the record on disk and remember it for the next store_add; no
+    // other record moves, so the rest of the hash stays valid
+    size_t r = (size_t)slots[pos];
+    HotAccount blank_hot;
+    ColdAccount blank_cold;
+    memset(&blank_hot, 0, sizeof(blank_hot));
+    memset(&blank_cold, 0, sizeof(blank_cold));
+    if (!push_free(r)) goto out;
+    if (!write_hot(r, &blank_hot)) {
+        free_count--;
+        goto out;
+    }
+    write_cold(r, &blank_cold); // Only clears personal data; the hot record already frees it
+    hot[r] = blank_hot;
+    slots[pos] = SLOT_DELETED;
+    ok = true;
+out:
+    pthread_rwlock_unlock(&store_lock);
+    return ok;
+}
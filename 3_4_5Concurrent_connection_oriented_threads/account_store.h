@@ -0,0 +1,66 @@
+#ifndef ACCOUNT_STORE_H
+#define ACCOUNT_STORE_H
+
+#include "common.h"
+
+// Accounts are split by how often their fields are used, into two files of
+// fixed-size records that share record numbers:
+//
+//   accounts.hot   account_no, PIN hash, balance in cents and a version;
+//                  32 bytes, so a record never straddles a cache line. The
+//                  whole file is read into one in-memory array at startup.
+//   accounts.cold  PIN, name, national ID and the account type as an enum
+//                  code. Never held in memory: store_get preads it.
+//
+// A hash from account_no to record number sits in front, so a balance check,
+// PIN check or balance update is one probe plus the one cache line holding
+// the hot record. 10M accounts take 320 MB of hot records and 64 MB of hash.
+// Every update is one pwrite of a single record per file it changes. A
+// deleted record is zeroed in place and reused by the next add.
+//
+// An accounts.dat of whole Account records (the format before the split) is
+// split into the two files the first time the store is opened without them;
+// it is not read or written afterwards.
+//
+// All functions are safe to call from concurrent client threads. Record
+// contents are guarded by LOCK_STRIPES rwlocks picked by account hash; the
+// index and arrays by one structural rwlock that only inserts and deletes
+// take exclusively. Lock order: structural lock first, then one stripe.
+// store_get_balance takes no stripe lock; it reads the one field it needs
+// atomically. store_check_pin does the same for the PIN hash and takes the
+// stripe lock only to confirm a match against the cold record.
+
+// Result of an atomic read-modify-write on one account
+typedef enum {
+    STORE_OK,
+    STORE_NOT_FOUND,
+    STORE_INSUFFICIENT_FUNDS,
+    STORE_IO_ERROR
+} StoreStatus;
+
+bool store_open(const char* hot_filename, const char* cold_filename, const char* legacy_filename);
+void store_close(void);
+
+bool store_exists(const char* account_no);
+bool store_get(const char* account_no, Account* out); // Reads the cold record too
+bool store_get_balance(const char* account_no, double* out);
+bool store_check_pin(const char* account_no, const char* pin);
+bool store_update(const Account* account);
+bool store_add(const Account* account);
+bool store_delete(const char* account_no);
+
+// Runs with the account's stripe lock held, right after a balance change is
+// written, so changes to one account reach it in the order they were made.
+// Must not block on I/O.
+typedef void (*store_commit_fn)(const char* account_no, double balance, void* arg);
+
+// Adds delta to the account's balance under the account's stripe lock, so
+// concurrent deposits/withdrawals on one account cannot lose updates while
+// unrelated accounts proceed in parallel. A change that would leave the
+// balance below min_balance is refused. *out_balance receives the balance
+// after the change. on_commit (may be NULL) is called with arg once the
+// change is applied, before the lock is released.
+StoreStatus store_apply_delta(const char* account_no, double delta, double min_balance, double* out_balance,
+                              store_commit_fn on_commit, void* arg);
+
+#endif
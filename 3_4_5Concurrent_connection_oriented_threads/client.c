@@ -6,7 +6,8 @@ void display_menu() {
     printf("2. Deposit\n");
     printf("3. Withdraw\n");
     printf("4. Check Balance\n");
-    printf("5. Exit\n");
+    printf("5. Statement\n");
+    printf("6. Exit\n");
     printf("Enter choice: ");
 }
 
@@ -48,7 +49,7 @@ int main() {
         scanf("%d", &choice);
         getchar(); // Consume newline
         
-        if (choice == 5) break;
+        if (choice == 6) break;
         
         switch (choice) {
             case 1: // Register
@@ -90,6 +91,14 @@ int main() {
                 
                 snprintf(buffer, sizeof(buffer), "%s %s", OP_CHECK, account_no);
                 break;
+
+            case 5: // Statement
+                printf("Enter account number: ");
+                fgets(account_no, sizeof(account_no), stdin);
+                trim_newline(account_no);
+
+                snprintf(buffer, sizeof(buffer), "%s %s", OP_STATEMENT, account_no);
+                break;
                 
             default:
                 printf("Invalid choice\n");
@@ -1,157 +1,98 @@
 #include "common.h"
+#include "account_store.h"
+#include "txn_ring.h"
+#include "group_commit.h"
+#include "txn_log.h"
 #include <sys/file.h>
 #include <dirent.h>
 
 // Check if account exists
 bool account_exists(const char* account_no) {
-    FILE* file = fopen(DB_FILENAME, "rb");
-    if (!file) {
-        return false;
-    }
-
-    Account account;
-    while (fread(&account, sizeof(Account), 1, file) == 1) {
-        if (strcmp(account.account_no, account_no) == 0) {
-            fclose(file);
-            return true;
-        }
-    }
-
-    fclose(file);
-    return false;
+    return store_exists(account_no);
 }
 
 // Get account details
 bool get_account(const char* account_no, Account* account) {
-    FILE* file = fopen(DB_FILENAME, "rb");
-    if (!file) {
-        return false;
-    }
-
-    while (fread(account, sizeof(Account), 1, file) == 1) {
-        if (strcmp(account->account_no, account_no) == 0) {
-            fclose(file);
-            return true;
-        }
-    }
-
-    fclose(file);
-    return false;
+    return store_get(account_no, account);
 }
 
 // Add a new account
 bool add_account(const Account* account) {
-    FILE* file = fopen(DB_FILENAME, "ab");
-    if (!file) {
-        return false;
-    }
-
-    if (fwrite(account, sizeof(Account), 1, file) != 1) {
-        fclose(file);
-        return false;
-    }
-
-    fclose(file);
-    return true;
+    return store_add(account);
 }
 
 // Update account details
 bool update_account(const Account* account) {
-    FILE* file = fopen(DB_FILENAME, "rb+");
-    if (!file) {
-        return false;
-    }
-
-    Account temp_account;
-    while (fread(&temp_account, sizeof(Account), 1, file) == 1) {
-        if (strcmp(temp_account.account_no, account->account_no) == 0) {
-            fseek(file, -sizeof(Account), SEEK_CUR);
-            if (fwrite(account, sizeof(Account), 1, file) != 1) {
-                fclose(file);
-                return false;
-            }
-            fclose(file);
-            return true;
-        }
-    }
-
-    fclose(file);
-    return false;
+    return store_update(account);
 }
 
 // Delete an account
 bool delete_account(const char* account_no) {
-    FILE* file = fopen(DB_FILENAME, "rb");
-    FILE* temp_file = fopen("temp.dat", "wb");
-    if (!file || !temp_file) {
-        if (file) fclose(file);
-        if (temp_file) fclose(temp_file);
-        return false;
-    }
-
-    Account account;
-    bool found = false;
-    while (fread(&account, sizeof(Account), 1, file) == 1) {
-        if (strcmp(account.account_no, account_no) != 0) {
-            fwrite(&account, sizeof(Account), 1, temp_file);
-        } else {
-            found = true;
-        }
-    }
+    if (!store_delete(account_no)) return false;
+    txn_ring_drop(account_no);
+    return true;
+}
 
-    fclose(file);
-    fclose(temp_file);
+// Ring writer: queues the record for the next group commit
+static bool enqueue_record(const char* account_no, TxnRecord* rec, void* arg) {
+    (void)account_no;
+    uint64_t* ticket = arg;
+    *ticket = txn_log_enqueue(rec);
+    return *ticket != 0;
+}
 
-    remove(DB_FILENAME);
-    rename("temp.dat", DB_FILENAME);
+// Numbers and queues a transaction without waiting for the disk, so it can
+// run under the store's stripe lock and log changes in the order they were
+// applied. Returns the ticket to pass to wait_transaction, or 0 on error.
+static uint64_t queue_transaction(const char* account_no, const char* type, double amount, double balance) {
+    TxnRecord rec;
+    txn_record_init(&rec, account_no, txn_op_from_name(type), amount, balance);
 
-    return found;
+    uint64_t ticket = 0;
+    if (!txn_ring_record(account_no, &rec, enqueue_record, &ticket)) return 0;
+    return ticket;
 }
 
-// Log a transaction
-void log_transaction(const char* account_no, const char* type, double amount, double balance) {
-    FILE* log_file = fopen(TRANSACTION_LOG_DIR "/transactions.log", "a");
-    if (!log_file) {
-        perror("Unable to open transaction log file");
-        return;
+// Returns once the queued record is on disk: the flusher thread writes and
+// fdatasyncs everything queued by concurrent clients as one batch. Returns
+// false if the record is not known to be durable; the request must then
+// not be acknowledged.
+static bool wait_transaction(uint64_t ticket, const char* account_no, const char* type, double amount) {
+    if (!gc_wait(ticket)) {
+        fprintf(stderr, "log_transaction: %s of %.2lf on %s is not durable\n", type, amount, account_no);
+        return false;
     }
+    return true;
+}
 
-    time_t now = time(NULL);
-    char* timestamp = ctime(&now);
-    timestamp[strlen(timestamp) - 1] = '\0';  // Remove the newline character
-
-    fprintf(log_file, "%s | Account: %s | Type: %s | Amount: %.2lf | Balance: %.2lf\n",
-            timestamp, account_no, type, amount, balance);
-
-    fclose(log_file);
+// Log a transaction and wait for it to be durable
+bool log_transaction(const char* account_no, const char* type, double amount, double balance) {
+    return wait_transaction(queue_transaction(account_no, type, amount, balance), account_no, type, amount);
 }
 
-// Get account transactions
-bool get_transactions(const char* account_no, char transactions[][MAX_LINE_LEN], int max_transactions) {
-    char log_filename[256];
-    snprintf(log_filename, sizeof(log_filename), "%s/transactions.log", TRANSACTION_LOG_DIR);
+// A DEPOSIT or WITHDRAW waiting for store_apply_delta to apply it
+typedef struct {
+    const char* type;
+    double amount;
+    uint64_t ticket; // Set by queue_applied
+} PendingTxn;
+
+// store_commit_fn: queues the log record under the stripe lock
+static void queue_applied(const char* account_no, double balance, void* arg) {
+    PendingTxn* txn = arg;
+    txn->ticket = queue_transaction(account_no, txn->type, txn->amount, balance);
+}
 
-    FILE* log_file = fopen(log_filename, "r");
-    if (!log_file) {
-        return false;
-    }
+// Get account transactions: the newest max_transactions, oldest first.
+// Returns how many were copied, or -1 if the log could not be read.
+int get_transactions(const char* account_no, char transactions[][MAX_LINE_LEN], int max_transactions) {
+    TxnRecord txns[TXN_RING_MAX];
+    if (max_transactions > TXN_RING_MAX) max_transactions = TXN_RING_MAX;
 
-    char line[MAX_LINE_LEN];
-    int count = 0;
-
-    while (fgets(line, sizeof(line), log_file)) {
-        if (strstr(line, account_no)) {
-            strncpy(transactions[count], line, MAX_LINE_LEN - 1);
-            transactions[count][MAX_LINE_LEN - 1] = '\0';
-            count++;
-            if (count >= max_transactions) {
-                break;
-            }
-        }
-    }
-
-    fclose(log_file);
-    return count > 0;
+    // A cache miss loads the ring by scanning the log (txn_log_scan)
+    int count = txn_ring_get(account_no, txns, max_transactions, txn_log_scan);
+    for (int i = 0; i < count; ++i) txn_record_render(&txns[i], transactions[i], MAX_LINE_LEN);
+    return count;
 }
 
 // Generate a 4-digit PIN
@@ -165,11 +106,7 @@ void generate_pin(char* pin) {
 
 // Validate a PIN
 bool validate_pin(const char* account_no, const char* pin) {
-    Account account;
-    if (get_account(account_no, &account)) {
-        return strcmp(account.pin, pin) == 0;
-    }
-    return false;
+    return store_check_pin(account_no, pin);
 }
 
 // Validate an amount
@@ -190,7 +127,7 @@ char* process_request(const char* request) {
     char account_no[MAX_ACCT_LEN];
     double amount = 0.0;
     char* response;
-    Account account;
+    double balance;
 
     if (!parse_message(request, operation, account_no, &amount)) {
         return strdup(RESP_INVALID_REQUEST);
@@ -203,6 +140,7 @@ char* process_request(const char* request) {
         }
 
         Account new_account;
+        memset(&new_account, 0, sizeof(new_account));
         strncpy(new_account.account_no, account_no, MAX_ACCT_LEN);
         generate_pin(new_account.pin);
         new_account.balance = 0.0;
@@ -223,14 +161,18 @@ char* process_request(const char* request) {
             return strdup(RESP_INVALID_AMOUNT);
         }
 
-        if (get_account(account_no, &account)) {
-            account.balance += amount;
-            if (update_account(&account)) {
-                log_transaction(account_no, "DEPOSIT", amount, account.balance);
-                return create_response(RESP_OK, account.balance);
-            }
+        PendingTxn txn = { "DEPOSIT", amount, 0 };
+        switch (store_apply_delta(account_no, amount, 0.0, &balance, queue_applied, &txn)) {
+            case STORE_OK:
+                if (!wait_transaction(txn.ticket, account_no, txn.type, amount)) {
+                    return strdup(RESP_ERROR); // Applied, but not durable: outcome unknown
+                }
+                return create_response(RESP_OK, balance);
+            case STORE_NOT_FOUND:
+                return strdup(RESP_ACCT_NOT_FOUND); // Deleted since the check above
+            default:
+                return strdup(RESP_ERROR);
         }
-        return strdup(RESP_ERROR);
     }
     else if (strcmp(operation, OP_WITHDRAW) == 0) {
         // Withdraw money
@@ -242,17 +184,20 @@ char* process_request(const char* request) {
             return strdup(RESP_INVALID_AMOUNT);
         }
 
-        if (get_account(account_no, &account)) {
-            if (account.balance < amount) {
+        PendingTxn txn = { "WITHDRAW", amount, 0 };
+        switch (store_apply_delta(account_no, -amount, 0.0, &balance, queue_applied, &txn)) {
+            case STORE_OK:
+                if (!wait_transaction(txn.ticket, account_no, txn.type, amount)) {
+                    return strdup(RESP_ERROR); // Applied, but not durable: outcome unknown
+                }
+                return create_response(RESP_OK, balance);
+            case STORE_INSUFFICIENT_FUNDS:
                 return strdup(RESP_INSUFFICIENT_FUNDS);
-            }
-            account.balance -= amount;
-            if (update_account(&account)) {
-                log_transaction(account_no, "WITHDRAW", amount, account.balance);
-                return create_response(RESP_OK, account.balance);
-            }
+            case STORE_NOT_FOUND:
+                return strdup(RESP_ACCT_NOT_FOUND);
+            default:
+                return strdup(RESP_ERROR);
         }
-        return strdup(RESP_ERROR);
     }
     else if (strcmp(operation, OP_CHECK) == 0) {
         // Check balance
@@ -260,12 +205,33 @@ char* process_request(const char* request) {
             return strdup(RESP_ACCT_NOT_FOUND);
         }
 
-        if (get_account(account_no, &account)) {
-            return create_response(RESP_OK, account.balance);
+        if (store_get_balance(account_no, &balance)) {
+            return create_response(RESP_OK, balance);
         }
         return strdup(RESP_ERROR);
     }
 
+    else if (strcmp(operation, OP_STATEMENT) == 0) {
+        // Last STATEMENT_LEN transactions as "OK TYPE AMOUNT BALANCE;..."
+        if (!account_exists(account_no)) {
+            return strdup(RESP_ACCT_NOT_FOUND);
+        }
+
+        char transactions[STATEMENT_LEN][MAX_LINE_LEN];
+        int count = get_transactions(account_no, transactions, STATEMENT_LEN);
+        if (count < 0) {
+            return strdup(RESP_ERROR);
+        }
+
+        char* statement = malloc(MAX_MSG_LEN);
+        snprintf(statement, MAX_MSG_LEN, "%s", RESP_OK);
+        for (int i = 0; i < count; ++i) {
+            size_t used = strlen(statement);
+            snprintf(statement + used, MAX_MSG_LEN - used, "%c%s", i == 0 ? ' ' : ';', transactions[i]);
+        }
+        return statement;
+    }
+
     return strdup(RESP_INVALID_REQUEST);
 }
 // Create a message string
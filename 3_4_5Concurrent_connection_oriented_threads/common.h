@@ -19,9 +19,22 @@
 #define MAX_MSG_LEN 256
 #define MAX_ACCT_LEN 16
 #define MAX_AMT_LEN 16
-#define DB_FILENAME "accounts.dat"
+#define DB_HOT_FILENAME "accounts.hot"
+#define DB_COLD_FILENAME "accounts.cold"
+#define DB_FILENAME "accounts.dat" // Pre-split format, imported once
 #define TRANSACTION_LOG_DIR "transactions"
+#define TRANSACTION_LOG_FILE TRANSACTION_LOG_DIR "/transactions.bin"
+#define TRANSACTION_TEXT_LOG_FILE TRANSACTION_LOG_DIR "/transactions.log" // Pre-binary format
 #define MAX_LINE_LEN 256
+#define STATEMENT_LEN 5 // Transactions returned by STATEMENT
+
+// Recent-transaction cache behind STATEMENT; override with -D at build time
+#ifndef STATEMENT_RING_SIZE
+#define STATEMENT_RING_SIZE 16           // Transactions kept per cached account
+#endif
+#ifndef STATEMENT_CACHE_BYTES
+#define STATEMENT_CACHE_BYTES (8u << 20) // Memory budget for all rings
+#endif
 
 // Operation codes
 #define OP_REGISTER "REGISTER"
@@ -64,8 +77,8 @@ bool get_account(const char* account_no, Account* account);
 bool update_account(const Account* account);
 bool add_account(const Account* account);
 bool delete_account(const char* account_no);
-void log_transaction(const char* account_no, const char* type, double amount, double balance);
-bool get_transactions(const char* account_no, char transactions[][MAX_LINE_LEN], int max_transactions);
+bool log_transaction(const char* account_no, const char* type, double amount, double balance);
+int get_transactions(const char* account_no, char transactions[][MAX_LINE_LEN], int max_transactions);
 
 // Utility functions
 void generate_pin(char* pin);
@@ -0,0 +1,245 @@
+#define _GNU_SOURCE // For pwritev, fdatasync
+#include "group_commit.h"
+#include <limits.h>
+#include <sys/uio.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+typedef struct {
+    struct iovec* iov; // iov_base is a malloc'd copy of each record
+    size_t count;
+    size_t capacity;
+    off_t offset;      // File offset of the first record
+} Batch;
+
+typedef struct {
+    uint64_t first, last;
+    uint64_t unwaited; // Tickets in the range not yet checked by gc_wait
+} FailedRange;
+
+static pthread_mutex_t gc_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gc_work = PTHREAD_COND_INITIALIZER;    // Flusher: records queued / closing
+static pthread_cond_t gc_durable = PTHREAD_COND_INITIALIZER; // Writers: a batch finished
+
+static int log_fd = -1;
+static pthread_t flusher;
+static bool running = false;
+
+static Batch queued;                // Filled by writers, swapped out by the flusher
+static uint64_t last_ticket = 0;    // Ticket of the newest queued record
+static uint64_t done_ticket = 0;    // Every ticket <= this has been written and synced (or failed)
+static off_t next_offset = 0;       // Where the next queued record goes
+
+// Batches whose write or fdatasync failed. Each record has a fixed offset,
+// assigned when it is queued, so a failed batch leaves a hole (or part of
+// its records) in the file and the next batch is written after it as usual.
+// A range is kept until gc_wait has answered for each of its tickets, so
+// the answer never depends on how many other batches failed meanwhile.
+static FailedRange* failed = NULL;
+static size_t failed_count = 0;
+static size_t failed_capacity = 0;
+static uint64_t unrecorded_below = 0; // A failure that found no memory to be recorded is at or below this
+
+// Caller holds gc_lock
+static void record_failure(uint64_t first, uint64_t last) {
+    if (failed_count == failed_capacity) {
+        size_t capacity = failed_capacity ? failed_capacity * 2 : 16;
+        FailedRange* grown = realloc(failed, capacity * sizeof(FailedRange));
+        if (!grown) {
+            // Out of memory: waiters at or below last can only be told "maybe failed"
+            unrecorded_below = last;
+            return;
+        }
+        failed = grown;
+        failed_capacity = capacity;
+    }
+    failed[failed_count++] = (FailedRange){ first, last, last - first + 1 };
+}
+
+// Caller holds gc_lock. consume counts the ticket as answered, so its range
+// can be dropped once every ticket in it has been.
+static bool ticket_failed(uint64_t ticket, bool consume) {
+    for (size_t i = 0; i < failed_count; ++i) {
+        FailedRange* range = &failed[i];
+        if (ticket < range->first || ticket > range->last) continue;
+        if (consume && --range->unwaited == 0) failed[i] = failed[--failed_count];
+        return true;
+    }
+    return ticket <= unrecorded_below;
+}
+
+// Writes the whole batch at offset, resuming after short writes, IOV_MAX
+// records per pwritev. Consumes the iovecs (their bases/lengths are advanced).
+static bool write_all(struct iovec* iov, size_t count, off_t offset) {
+    size_t next = 0;
+    while (next < count) {
+        int n = (int)(count - next > IOV_MAX ? IOV_MAX : count - next);
+        ssize_t written = pwritev(log_fd, &iov[next], n, offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            perror("group commit: pwritev failed");
+            return false;
+        }
+        offset += written;
+        while (next < count && (size_t)written >= iov[next].iov_len) {
+            written -= (ssize_t)iov[next].iov_len;
+            next++;
+        }
+        if (written > 0) { // Short write inside a record
+            iov[next].iov_base = (char*)iov[next].iov_base + written;
+            iov[next].iov_len -= (size_t)written;
+        }
+    }
+    return true;
+}
+
+static void* flusher_main(void* arg) {
+    (void)arg;
+    Batch flushing = {0};
+    void** bases = NULL; // Original iov_base pointers, write_all moves them
+    size_t bases_capacity = 0;
+
+    pthread_mutex_lock(&gc_lock);
+    for (;;) {
+        while (queued.count == 0 && running) pthread_cond_wait(&gc_work, &gc_lock);
+        if (queued.count == 0) break; // Closing and drained
+
+        // Take the whole queue; writers go on filling the swapped-in empty one
+        Batch tmp = flushing;
+        flushing = queued;
+        queued = tmp;
+        queued.offset = next_offset;
+        uint64_t batch_last = last_ticket;
+        pthread_mutex_unlock(&gc_lock);
+
+        if (bases_capacity < flushing.count) {
+            // On failure the old buffer is kept, and only this batch fails
+            void** grown = realloc(bases, flushing.capacity * sizeof(void*));
+            if (grown) {
+                bases = grown;
+                bases_capacity = flushing.capacity;
+            }
+        }
+        bool have_bases = bases_capacity >= flushing.count;
+        if (have_bases) {
+            for (size_t i = 0; i < flushing.count; ++i) bases[i] = flushing.iov[i].iov_base;
+        } else {
+            perror("group commit: realloc failed");
+        }
+        bool ok = have_bases && write_all(flushing.iov, flushing.count, flushing.offset);
+        if (ok && fdatasync(log_fd) == -1) {
+            perror("group commit: fdatasync failed");
+            ok = false;
+        }
+        for (size_t i = 0; i < flushing.count; ++i) free(have_bases ? bases[i] : flushing.iov[i].iov_base);
+        uint64_t batch_first = batch_last - flushing.count + 1;
+        flushing.count = 0;
+
+        pthread_mutex_lock(&gc_lock);
+        if (!ok) {
+            fprintf(stderr, "group commit: tickets %llu-%llu are not durable\n",
+                    (unsigned long long)batch_first, (unsigned long long)batch_last);
+            record_failure(batch_first, batch_last);
+        }
+        done_ticket = batch_last;
+        pthread_cond_broadcast(&gc_durable);
+    }
+    pthread_mutex_unlock(&gc_lock);
+
+    free(flushing.iov);
+    free(bases);
+    return NULL;
+}
+
+bool gc_open(const char* filename) {
+    // Not O_APPEND: every batch is written at the offsets its records were given
+    log_fd = open(filename, O_WRONLY | O_CREAT, 0644);
+    if (log_fd == -1) {
+        perror("gc_open: open failed");
+        return false;
+    }
+    next_offset = lseek(log_fd, 0, SEEK_END);
+    queued.offset = next_offset;
+    running = true;
+    if (pthread_create(&flusher, NULL, flusher_main, NULL) != 0) {
+        perror("gc_open: pthread_create failed");
+        running = false;
+        close(log_fd);
+        log_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+void gc_close(void) {
+    pthread_mutex_lock(&gc_lock);
+    if (!running) {
+        pthread_mutex_unlock(&gc_lock);
+        return;
+    }
+    running = false;
+    pthread_cond_signal(&gc_work);
+    pthread_mutex_unlock(&gc_lock);
+
+    pthread_join(flusher, NULL);
+    free(queued.iov);
+    queued = (Batch){0};
+    free(failed);
+    failed = NULL;
+    failed_count = failed_capacity = 0;
+    close(log_fd);
+    log_fd = -1;
+}
+
+uint64_t gc_enqueue(const char* data, size_t len) {
+    char* copy = malloc(len);
+    if (!copy) {
+        perror("gc_enqueue: malloc failed");
+        return 0;
+    }
+    memcpy(copy, data, len);
+
+    uint64_t ticket = 0;
+    pthread_mutex_lock(&gc_lock);
+    if (running && queued.count == queued.capacity) {
+        size_t capacity = queued.capacity ? queued.capacity * 2 : 64;
+        struct iovec* iov = realloc(queued.iov, capacity * sizeof(struct iovec));
+        if (iov) {
+            queued.iov = iov;
+            queued.capacity = capacity;
+        }
+    }
+    if (running && queued.count < queued.capacity) {
+        queued.iov[queued.count].iov_base = copy;
+        queued.iov[queued.count].iov_len = len;
+        queued.count++;
+        next_offset += (off_t)len;
+        ticket = ++last_ticket;
+        pthread_cond_signal(&gc_work);
+    }
+    pthread_mutex_unlock(&gc_lock);
+
+    if (ticket == 0) free(copy);
+    return ticket;
+}
+
+bool gc_wait(uint64_t ticket) {
+    if (ticket == 0) return false;
+    pthread_mutex_lock(&gc_lock);
+    while (done_ticket < ticket) pthread_cond_wait(&gc_durable, &gc_lock);
+    bool ok = !ticket_failed(ticket, true);
+    pthread_mutex_unlock(&gc_lock);
+    return ok;
+}
+
+bool gc_sync(void) {
+    pthread_mutex_lock(&gc_lock);
+    uint64_t ticket = last_ticket;
+    while (done_ticket < ticket) pthread_cond_wait(&gc_durable, &gc_lock);
+    // The ticket's owner still has to ask about it, so don't consume it
+    bool ok = ticket == 0 || !ticket_failed(ticket, false);
+    pthread_mutex_unlock(&gc_lock);
+    return ok;
+}
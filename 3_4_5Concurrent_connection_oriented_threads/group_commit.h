@@ -0,0 +1,34 @@
+#ifndef GROUP_COMMIT_H
+#define GROUP_COMMIT_H
+
+#include "common.h"
+#include <stdint.h>
+
+// Group commit for an append-only log.
+//
+// Client threads enqueue records and get back a ticket. One flusher thread
+// takes everything queued so far, writes it with a single pwritev and makes
+// it durable with a single fdatasync, then wakes every thread whose ticket
+// was in the batch. While one batch is being synced the next one fills up,
+// so the fsync cost is shared by all concurrent writers.
+//
+// Records go to the file in queue order, each at the offset it was given
+// when queued. A batch that fails to write or sync fails only its own
+// tickets; its records may or may not be in the file, and later batches
+// still land at their own offsets.
+
+bool gc_open(const char* filename);
+// Flushes whatever is still queued, then stops the flusher.
+void gc_close(void);
+
+// Queues one record (copied) and returns its ticket, or 0 on error. Never
+// blocks on I/O, so it may be called with other locks held.
+uint64_t gc_enqueue(const char* data, size_t len);
+// Blocks until the record with this ticket is on disk. Returns false if its
+// batch failed to write or sync. Call it once per ticket: a failed batch is
+// remembered until each of its tickets has been waited for.
+bool gc_wait(uint64_t ticket);
+// Blocks until everything enqueued so far is on disk.
+bool gc_sync(void);
+
+#endif
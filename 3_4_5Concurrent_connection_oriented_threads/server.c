@@ -1,5 +1,8 @@
 #include <sys/stat.h>  // For mkdir()
 #include "common.h"
+#include "account_store.h"
+#include "txn_ring.h"
+#include "txn_log.h"
 
 typedef struct {
     int sockfd;
@@ -58,10 +61,25 @@ int main() {
         exit(EXIT_FAILURE);
     }
     
+    // Load the hot account records and build the account_no -> record index once
+    if (!store_open(DB_HOT_FILENAME, DB_COLD_FILENAME, DB_FILENAME)) {
+        fprintf(stderr, "Failed to open %s\n", DB_HOT_FILENAME);
+        exit(EXIT_FAILURE);
+    }
+
+    if (!txn_ring_init(STATEMENT_RING_SIZE, STATEMENT_CACHE_BYTES)) {
+        fprintf(stderr, "Failed to allocate the statement cache\n");
+        exit(EXIT_FAILURE);
+    }
+
     printf("Banking server started on port %d\n", PORT);
     
     // Create transaction directory if not exists
     mkdir(TRANSACTION_LOG_DIR, 0777);
+    if (!txn_log_open(TRANSACTION_LOG_FILE, TRANSACTION_TEXT_LOG_FILE)) {
+        fprintf(stderr, "Failed to open the transaction log\n");
+        exit(EXIT_FAILURE);
+    }
     
     // Accept connections
     while (1) {
@@ -88,5 +106,8 @@ int main() {
     }
     
     close(server_fd);
+    txn_log_close();
+    store_close();
+    txn_ring_shutdown();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,279 @@
+#define _GNU_SOURCE // For strptime, timegm
+#include "txn_log.h"
+#include "account_hash.h"
+#include "group_commit.h"
+#include <sys/stat.h>
+
+#define SCAN_CHUNK 1024      // Records per read while building the index
+#define INDEX_MIN_SLOTS 1024 // Account hash size, always a power of two
+
+static const char* op_names[] = { "UNKNOWN", "OPEN_ACCOUNT", "DEPOSIT", "WITHDRAW", "CLOSE_ACCOUNT" };
+#define OP_COUNT (sizeof(op_names) / sizeof(op_names[0]))
+
+// Per-account index: the record numbers of each account's transactions in
+// append order, so a scan preads only that account's records
+typedef struct {
+    char account_no[MAX_ACCT_LEN];
+    uint32_t* seqs;
+    uint32_t count;
+    uint32_t capacity;
+} IndexEntry;
+
+static pthread_mutex_t seq_lock = PTHREAD_MUTEX_INITIALIZER; // Keeps seq in queue order, guards the index
+static uint32_t next_seq = 0;
+static char log_filename[256];
+
+static IndexEntry* index_slots = NULL; // Open addressing, empty when account_no[0] == '\0'
+static size_t index_capacity = 0;
+static size_t index_used = 0;
+
+static IndexEntry* index_probe(IndexEntry* table, size_t capacity, const char* account_no) {
+    size_t mask = capacity - 1;
+    for (size_t i = hash_account_no(account_no) & mask;; i = (i + 1) & mask) {
+        if (table[i].account_no[0] == '\0' || strncmp(table[i].account_no, account_no, MAX_ACCT_LEN) == 0) {
+            return &table[i];
+        }
+    }
+}
+
+static bool index_grow(void) {
+    size_t new_capacity = index_capacity ? index_capacity * 2 : INDEX_MIN_SLOTS;
+    IndexEntry* table = calloc(new_capacity, sizeof(IndexEntry));
+    if (!table) return false;
+    for (size_t i = 0; i < index_capacity; ++i) {
+        if (index_slots[i].account_no[0]) *index_probe(table, new_capacity, index_slots[i].account_no) = index_slots[i];
+    }
+    free(index_slots);
+    index_slots = table;
+    index_capacity = new_capacity;
+    return true;
+}
+
+// Caller holds seq_lock
+static bool index_add(const TxnRecord* rec) {
+    if (!rec->account_no[0]) return true;
+    if ((index_used + 1) * 10 > index_capacity * 7 && !index_grow()) return false;
+
+    IndexEntry* entry = index_probe(index_slots, index_capacity, rec->account_no);
+    if (!entry->account_no[0]) {
+        memcpy(entry->account_no, rec->account_no, MAX_ACCT_LEN);
+        index_used++;
+    }
+    if (entry->count == entry->capacity) {
+        uint32_t new_capacity = entry->capacity ? entry->capacity * 2 : 8;
+        uint32_t* grown = realloc(entry->seqs, new_capacity * sizeof(uint32_t));
+        if (!grown) return false;
+        entry->seqs = grown;
+        entry->capacity = new_capacity;
+    }
+    entry->seqs[entry->count++] = rec->seq;
+    return true;
+}
+
+static void index_free(void) {
+    for (size_t i = 0; i < index_capacity; ++i) free(index_slots[i].seqs);
+    free(index_slots);
+    index_slots = NULL;
+    index_capacity = index_used = 0;
+}
+
+// One pass over the log at startup; afterwards the index is kept up to date
+// by txn_log_enqueue
+static bool index_build(const char* filename) {
+    FILE* log_file = fopen(filename, "rb");
+    if (!log_file) return errno == ENOENT;
+
+    TxnRecord* chunk = malloc(SCAN_CHUNK * sizeof(TxnRecord));
+    bool ok = chunk != NULL;
+    uint32_t seq = 0;
+    size_t n;
+    while (ok && (n = fread(chunk, sizeof(TxnRecord), SCAN_CHUNK, log_file)) > 0) {
+        for (size_t i = 0; ok && i < n; ++i) {
+            chunk[i].seq = seq++; // Position is authoritative
+            ok = index_add(&chunk[i]);
+        }
+    }
+    ok = ok && !ferror(log_file);
+    fclose(log_file);
+    free(chunk);
+    if (!ok) perror("txn_log_open: cannot index the log");
+    return ok;
+}
+
+int64_t txn_to_cents(double amount) {
+    return (int64_t)(amount * 100.0 + (amount < 0 ? -0.5 : 0.5));
+}
+
+const char* txn_op_name(uint8_t op) {
+    return op < OP_COUNT ? op_names[op] : op_names[0];
+}
+
+uint8_t txn_op_from_name(const char* name) {
+    for (uint8_t op = 1; op < OP_COUNT; ++op) {
+        if (strcmp(op_names[op], name) == 0) return op;
+    }
+    return 0;
+}
+
+// Records keep whole seconds, so the coarse clock (the last tick, no
+// hardware counter read) is precise enough
+static int64_t txn_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    return (int64_t)ts.tv_sec;
+}
+
+void txn_record_init(TxnRecord* rec, const char* account_no, uint8_t op, double amount, double balance) {
+    memset(rec, 0, sizeof(*rec));
+    rec->timestamp = txn_now();
+    rec->amount_cents = txn_to_cents(amount);
+    rec->balance_cents = txn_to_cents(balance);
+    rec->op = op;
+    strncpy(rec->account_no, account_no, MAX_ACCT_LEN - 1);
+}
+
+// Prints cents as "-12.34" without going through double
+static int format_cents(char* out, size_t len, int64_t cents) {
+    uint64_t abs_cents = cents < 0 ? (uint64_t)0 - (uint64_t)cents : (uint64_t)cents;
+    return snprintf(out, len, "%s%llu.%02llu", cents < 0 ? "-" : "",
+                    (unsigned long long)(abs_cents / 100), (unsigned long long)(abs_cents % 100));
+}
+
+void txn_record_render(const TxnRecord* rec, char* out, size_t out_len) {
+    char amount[32], balance[32];
+    format_cents(amount, sizeof(amount), rec->amount_cents);
+    format_cents(balance, sizeof(balance), rec->balance_cents);
+    snprintf(out, out_len, "%s %s %s", txn_op_name(rec->op), amount, balance);
+}
+
+bool txn_log_import_text(const char* txt_filename, const char* bin_filename, size_t* out_records) {
+    FILE* in = fopen(txt_filename, "r");
+    if (!in) {
+        perror("txn_log_import_text: cannot open text log");
+        return false;
+    }
+    FILE* out = fopen(bin_filename, "wx");
+    if (!out) {
+        perror("txn_log_import_text: cannot create binary log");
+        fclose(in);
+        return false;
+    }
+
+    // "Thu Oct 16 21:11:19 2026 | Account: 1001 | Type: DEPOSIT | Amount: 5.00 | Balance: 5.00"
+    char line[MAX_LINE_LEN], acct[MAX_ACCT_LEN], type[16];
+    double amount, balance;
+    uint32_t seq = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), in)) {
+        const char* fields = strstr(line, "| Account: ");
+        if (!fields || sscanf(fields, "| Account: %15s | Type: %15s | Amount: %lf | Balance: %lf",
+                              acct, type, &amount, &balance) != 4) {
+            continue;
+        }
+        uint8_t op = txn_op_from_name(type);
+        if (op == 0) continue;
+
+        TxnRecord rec;
+        txn_record_init(&rec, acct, op, amount, balance);
+        struct tm tm_buf;
+        memset(&tm_buf, 0, sizeof(tm_buf));
+        tm_buf.tm_isdst = -1;
+        if (strptime(line, "%a %b %d %H:%M:%S %Y", &tm_buf)) rec.timestamp = (int64_t)mktime(&tm_buf);
+        rec.seq = seq++;
+        ok = fwrite(&rec, sizeof(rec), 1, out) == 1;
+    }
+    fclose(in);
+
+    ok = ok && fflush(out) == 0 && fsync(fileno(out)) == 0;
+    if (fclose(out) != 0) ok = false;
+    if (!ok) {
+        perror("txn_log_import_text: write failed");
+        remove(bin_filename);
+        return false;
+    }
+    if (out_records) *out_records = seq;
+    return true;
+}
+
+bool txn_log_open(const char* filename, const char* legacy_txt) {
+    snprintf(log_filename, sizeof(log_filename), "%s", filename);
+
+    if (access(filename, F_OK) != 0 && access(legacy_txt, F_OK) == 0) {
+        size_t imported = 0;
+        if (!txn_log_import_text(legacy_txt, filename, &imported)) return false;
+        printf("Converted %zu transactions from %s to %s\n", imported, legacy_txt, filename);
+    }
+
+    // A crash mid-write can leave a partial record at the end
+    struct stat st;
+    if (stat(filename, &st) == 0) {
+        off_t whole = st.st_size - st.st_size % (off_t)sizeof(TxnRecord);
+        if (whole != st.st_size && truncate(filename, whole) == -1) {
+            perror("txn_log_open: truncate failed");
+            return false;
+        }
+        next_seq = (uint32_t)(whole / (off_t)sizeof(TxnRecord));
+    }
+    pthread_mutex_lock(&seq_lock);
+    bool indexed = index_build(filename);
+    pthread_mutex_unlock(&seq_lock);
+    return indexed && gc_open(filename);
+}
+
+void txn_log_close(void) {
+    gc_close();
+    pthread_mutex_lock(&seq_lock);
+    index_free();
+    pthread_mutex_unlock(&seq_lock);
+}
+
+uint64_t txn_log_enqueue(TxnRecord* rec) {
+    pthread_mutex_lock(&seq_lock);
+    rec->seq = next_seq;
+    uint64_t ticket = gc_enqueue((const char*)rec, sizeof(*rec));
+    if (ticket != 0) {
+        next_seq++;
+        // A record the index misses is left out of statements, nothing else
+        if (!index_add(rec)) fprintf(stderr, "txn_log: cannot index record %u\n", rec->seq);
+    }
+    pthread_mutex_unlock(&seq_lock);
+    return ticket;
+}
+
+int txn_log_scan(const char* account_no, TxnRecord* out, int max) {
+    uint32_t seqs[max > 0 ? max : 1];
+    int count = 0;
+    pthread_mutex_lock(&seq_lock);
+    IndexEntry* entry = index_slots ? index_probe(index_slots, index_capacity, account_no) : NULL;
+    if (entry && entry->account_no[0]) {
+        count = entry->count < (uint32_t)max ? (int)entry->count : max;
+        memcpy(seqs, entry->seqs + entry->count - count, (size_t)count * sizeof(uint32_t));
+    }
+    pthread_mutex_unlock(&seq_lock);
+    if (count == 0) return 0;
+
+    gc_sync(); // The indexed records may still be queued
+
+    int fd = open(log_filename, O_RDONLY);
+    if (fd == -1) return -1;
+    // Records of one account are often adjacent; read each run with one pread
+    int done = 0;
+    while (done < count) {
+        int run = 1;
+        while (done + run < count && seqs[done + run] == seqs[done] + (uint32_t)run) run++;
+        size_t bytes = (size_t)run * sizeof(TxnRecord);
+        if (pread(fd, &out[done], bytes, (off_t)seqs[done] * (off_t)sizeof(TxnRecord)) != (ssize_t)bytes) {
+            close(fd);
+            return -1;
+        }
+        done += run;
+    }
+    close(fd);
+
+    // A record whose group commit failed may be missing (zeroes) or torn
+    int kept = 0;
+    for (int i = 0; i < count; ++i) {
+        if (strncmp(out[i].account_no, account_no, MAX_ACCT_LEN) == 0 && out[i].seq == seqs[i]) out[kept++] = out[i];
+    }
+    return kept;
+}
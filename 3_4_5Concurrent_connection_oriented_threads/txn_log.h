@@ -0,0 +1,67 @@
+#ifndef TXN_LOG_H
+#define TXN_LOG_H
+
+#include "common.h"
+#include <stdint.h>
+
+// Binary transaction log, transactions/transactions.bin.
+//
+// The file is a flat array of fixed-size TxnRecords (native byte order);
+// record i starts at i * sizeof(TxnRecord) and has seq == i. Money is stored
+// in integer cents, and text is only produced on the way out, by
+// txn_record_render. Appends go through the group commit flusher.
+//
+// The text log older servers wrote (transactions/transactions.log) is
+// converted on the first start without a binary log, or up front with the
+// txnconvert tool.
+
+typedef enum {
+    TXN_OPEN_ACCOUNT = 1,
+    TXN_DEPOSIT,
+    TXN_WITHDRAW,
+    TXN_CLOSE_ACCOUNT
+} TxnOp;
+
+typedef struct {
+    int64_t timestamp;     // Unix time
+    int64_t amount_cents;
+    int64_t balance_cents; // Balance after the transaction
+    uint32_t seq;          // Record number within the log
+    uint8_t op;            // TxnOp
+    uint8_t reserved[3];
+    char account_no[MAX_ACCT_LEN]; // NUL padded
+} TxnRecord;
+
+_Static_assert(sizeof(TxnRecord) == 48, "record size is part of the file format");
+
+int64_t txn_to_cents(double amount);
+const char* txn_op_name(uint8_t op);        // "DEPOSIT" etc., "UNKNOWN" for bad codes
+uint8_t txn_op_from_name(const char* name); // 0 if not a known operation
+
+// Fills in a record stamped with the current time (seq is set on enqueue).
+void txn_record_init(TxnRecord* rec, const char* account_no, uint8_t op, double amount, double balance);
+
+// Renders "TYPE AMOUNT BALANCE", the form STATEMENT sends.
+void txn_record_render(const TxnRecord* rec, char* out, size_t out_len);
+
+// Opens the log (converting legacy_txt first if the log doesn't exist yet),
+// drops a torn tail record, and starts the group commit flusher.
+bool txn_log_open(const char* filename, const char* legacy_txt);
+void txn_log_close(void);
+
+// Numbers the record and queues it for the next group commit. Returns the
+// group commit ticket to gc_wait on, or 0 on error. A record whose commit
+// failed keeps its seq; that position in the file is skipped by scans.
+uint64_t txn_log_enqueue(TxnRecord* rec);
+
+// Reads the account's newest (up to) max records, oldest first, into out,
+// after waiting for everything already queued to reach the file. An
+// in-memory index of each account's record numbers, built when the log is
+// opened and extended on enqueue, means only that account's records are
+// read. Returns the number found, or -1 on error.
+int txn_log_scan(const char* account_no, TxnRecord* out, int max);
+
+// One-shot conversion of a text transactions.log into a new binary log.
+bool txn_log_import_text(const char* txt_filename, const char* log_filename, size_t* out_records);
+
+#endif
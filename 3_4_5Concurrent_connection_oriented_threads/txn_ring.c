@@ -0,0 +1,247 @@
+#include "txn_ring.h"
+#include "account_hash.h"
+#include <stdint.h>
+
+#define SLOT_EMPTY   -1
+#define SLOT_DELETED -2
+
+typedef struct {
+    char account_no[MAX_ACCT_LEN];  // "" when the entry is free
+    bool referenced;                // CLOCK bit, set on every hit
+    bool loading;                   // Claimed by a miss whose loader has not returned yet
+    uint32_t generation;            // Bumped whenever the entry is freed
+    int head;                       // Index of the oldest transaction
+    int count;
+    TxnRecord* ring;                 // ring_size entries in the shared pool
+} RingEntry;
+
+static pthread_mutex_t ring_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int ring_size = 0;
+static RingEntry* entries = NULL;
+static TxnRecord* pool = NULL;
+static size_t entry_capacity = 0;
+static size_t clock_hand = 0;
+
+static int32_t* slots = NULL;      // account_no -> entry, open addressing
+static size_t slot_capacity = 0;
+static size_t slot_used = 0;       // Live + deleted slots
+
+// Returns the slot holding account_no, or -(free slot + 1) if absent
+static long probe(const char* account_no) {
+    size_t mask = slot_capacity - 1;
+    size_t i = hash_account_no(account_no) & mask;
+    long first_free = -1;
+
+    for (size_t n = 0; n < slot_capacity; ++n, i = (i + 1) & mask) {
+        int32_t s = slots[i];
+        if (s == SLOT_EMPTY) {
+            return -((first_free >= 0 ? first_free : (long)i) + 1);
+        }
+        if (s == SLOT_DELETED) {
+            if (first_free < 0) first_free = (long)i;
+            continue;
+        }
+        if (strncmp(entries[s].account_no, account_no, MAX_ACCT_LEN) == 0) {
+            return (long)i;
+        }
+    }
+    return -(first_free + 1);
+}
+
+// Evictions leave tombstones behind; clear them once they crowd the table
+static void rebuild_slots(void) {
+    for (size_t i = 0; i < slot_capacity; ++i) slots[i] = SLOT_EMPTY;
+    slot_used = 0;
+    for (size_t e = 0; e < entry_capacity; ++e) {
+        if (entries[e].account_no[0] == '\0') continue;
+        slots[-probe(entries[e].account_no) - 1] = (int32_t)e;
+        slot_used++;
+    }
+}
+
+static void remove_entry(long slot) {
+    RingEntry* entry = &entries[slots[slot]];
+    entry->account_no[0] = '\0';
+    entry->count = 0;
+    entry->loading = false;
+    entry->generation++;
+    slots[slot] = SLOT_DELETED;
+}
+
+// Picks a free entry, or evicts one that has not been hit since the clock
+// hand last passed it. The second lap always succeeds.
+static RingEntry* claim_entry(void) {
+    for (;;) {
+        RingEntry* entry = &entries[clock_hand];
+        clock_hand = (clock_hand + 1) % entry_capacity;
+        if (entry->account_no[0] == '\0') return entry;
+        if (entry->referenced) {
+            entry->referenced = false;
+            continue;
+        }
+        remove_entry(probe(entry->account_no));
+        return entry;
+    }
+}
+
+static void push_entry(RingEntry* entry, const TxnRecord* txn) {
+    entry->ring[(entry->head + entry->count) % ring_size] = *txn;
+    if (entry->count < ring_size) {
+        entry->count++;
+    } else {
+        entry->head = (entry->head + 1) % ring_size; // Overwrote the oldest
+    }
+}
+
+bool txn_ring_init(int size, size_t budget_bytes) {
+    if (size < 1) size = 1;
+    if (size > TXN_RING_MAX) size = TXN_RING_MAX;
+
+    // Per cached account: the entry, its ring, and two hash slots
+    size_t per_account = sizeof(RingEntry) + (size_t)size * sizeof(TxnRecord) + 2 * sizeof(int32_t);
+    size_t capacity = budget_bytes / per_account;
+
+    pthread_mutex_lock(&ring_lock);
+    ring_size = size;
+    entry_capacity = capacity;
+    bool ok = true;
+    if (capacity > 0) {
+        slot_capacity = 1;
+        while (slot_capacity < 2 * capacity) slot_capacity *= 2;
+
+        entries = calloc(capacity, sizeof(RingEntry));
+        pool = malloc(capacity * (size_t)size * sizeof(TxnRecord));
+        slots = malloc(slot_capacity * sizeof(int32_t));
+        ok = entries && pool && slots;
+        if (ok) {
+            for (size_t e = 0; e < capacity; ++e) entries[e].ring = &pool[e * (size_t)size];
+            for (size_t i = 0; i < slot_capacity; ++i) slots[i] = SLOT_EMPTY;
+            slot_used = 0;
+        }
+    }
+    pthread_mutex_unlock(&ring_lock);
+
+    if (!ok) {
+        perror("txn_ring_init: malloc failed");
+        txn_ring_shutdown();
+    }
+    return ok;
+}
+
+void txn_ring_shutdown(void) {
+    pthread_mutex_lock(&ring_lock);
+    free(entries);
+    free(pool);
+    free(slots);
+    entries = NULL;
+    pool = NULL;
+    slots = NULL;
+    entry_capacity = slot_capacity = slot_used = 0;
+    clock_hand = 0;
+    pthread_mutex_unlock(&ring_lock);
+}
+
+// Folds the loaded records into the ring of an entry that has been
+// collecting live transactions while the loader ran. Both are in seq order;
+// a transaction the loader already saw is kept once.
+static void merge_loaded(RingEntry* entry, const TxnRecord* loaded, int loaded_count) {
+    TxnRecord live[TXN_RING_MAX];
+    int live_count = entry->count;
+    for (int i = 0; i < live_count; ++i) live[i] = entry->ring[(entry->head + i) % ring_size];
+
+    entry->head = 0;
+    entry->count = 0;
+    int a = 0, b = 0;
+    while (a < loaded_count || b < live_count) {
+        if (b == live_count || (a < loaded_count && loaded[a].seq < live[b].seq)) {
+            push_entry(entry, &loaded[a++]);
+        } else {
+            if (a < loaded_count && loaded[a].seq == live[b].seq) a++;
+            push_entry(entry, &live[b++]);
+        }
+    }
+}
+
+int txn_ring_get(const char* account_no, TxnRecord* out, int max, txn_ring_loader load) {
+    int n = -1;
+    pthread_mutex_lock(&ring_lock);
+
+    if (entry_capacity == 0) {
+        pthread_mutex_unlock(&ring_lock);
+        return load(account_no, out, max); // Cache disabled
+    }
+
+    long pos = probe(account_no);
+    RingEntry* entry = pos >= 0 ? &entries[slots[pos]] : NULL;
+    if (!entry || entry->loading) {
+        // Miss. The loader waits for the log to reach the disk, so it runs
+        // without the lock; txn_ring_record would otherwise stall behind it.
+        // A new entry goes live first and collects the transactions recorded
+        // meanwhile, which are merged with what the loader found.
+        bool install = !entry;
+        uint32_t generation = 0;
+        if (install) {
+            entry = claim_entry();
+            if ((slot_used + 1) * 10 > slot_capacity * 7) rebuild_slots();
+            pos = probe(account_no); // The eviction/rebuild may have moved the free slot
+            size_t slot = (size_t)(-pos - 1);
+            if (slots[slot] == SLOT_EMPTY) slot_used++;
+            slots[slot] = (int32_t)(entry - entries);
+            strncpy(entry->account_no, account_no, MAX_ACCT_LEN - 1);
+            entry->account_no[MAX_ACCT_LEN - 1] = '\0';
+            entry->head = 0;
+            entry->count = 0;
+            entry->loading = true;
+            entry->referenced = true;
+            generation = entry->generation;
+        }
+        pthread_mutex_unlock(&ring_lock);
+
+        TxnRecord warm[TXN_RING_MAX];
+        int count = load(account_no, warm, install ? ring_size : (max < TXN_RING_MAX ? max : TXN_RING_MAX));
+
+        pthread_mutex_lock(&ring_lock);
+        // Another thread's load, or an entry evicted or dropped while loading:
+        // answer from what was loaded and leave the cache alone
+        bool live = install && entry->generation == generation;
+        if (live && count < 0) {
+            remove_entry(probe(account_no));
+        } else if (live) {
+            merge_loaded(entry, warm, count);
+            entry->loading = false;
+        } else {
+            n = count < max ? count : max;
+            if (n > 0) memcpy(out, warm + count - n, (size_t)n * sizeof(TxnRecord));
+        }
+        if (!live || count < 0) goto out;
+    }
+
+    entry->referenced = true;
+    n = entry->count < max ? entry->count : max;
+    int first = entry->head + entry->count - n; // Skip the older transactions
+    for (int i = 0; i < n; ++i) out[i] = entry->ring[(first + i) % ring_size];
+out:
+    pthread_mutex_unlock(&ring_lock);
+    return n;
+}
+
+bool txn_ring_record(const char* account_no, TxnRecord* txn, txn_ring_writer write, void* arg) {
+    pthread_mutex_lock(&ring_lock);
+    bool ok = write(account_no, txn, arg);
+    if (ok && entry_capacity > 0) {
+        long pos = probe(account_no);
+        if (pos >= 0) push_entry(&entries[slots[pos]], txn);
+    }
+    pthread_mutex_unlock(&ring_lock);
+    return ok;
+}
+
+void txn_ring_drop(const char* account_no) {
+    pthread_mutex_lock(&ring_lock);
+    if (entry_capacity > 0) {
+        long pos = probe(account_no);
+        if (pos >= 0) remove_entry(pos);
+    }
+    pthread_mutex_unlock(&ring_lock);
+}
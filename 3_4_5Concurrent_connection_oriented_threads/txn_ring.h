@@ -0,0 +1,48 @@
+#ifndef TXN_RING_H
+#define TXN_RING_H
+
+#include "common.h"
+#include "txn_log.h"
+
+// In-memory cache of each account's most recent transactions, so STATEMENT
+// is normally served without reading the transaction log.
+//
+// Every cached account owns a ring of its last ring_size transactions. A ring
+// is filled lazily by a loader the first time the account's statement is
+// requested, then kept current by log_transaction. The number of cached
+// accounts is bounded by a memory budget; when it is full the least recently
+// used ring (CLOCK approximation) is evicted.
+//
+// One mutex guards the cache. txn_ring_record runs the log writer under it.
+// The loader runs without it: a miss puts the account's empty ring in place
+// first, so transactions recorded during the load land there, and merges the
+// loaded ones in by seq afterwards.
+
+#define TXN_RING_MAX 64 // Upper bound on ring_size
+
+// Fills out with up to max of the account's newest transactions, oldest
+// first (so in seq order), and returns how many (or -1 on error). Called
+// without the cache lock.
+typedef int (*txn_ring_loader)(const char* account_no, TxnRecord* out, int max);
+// Hands one transaction to the log. Runs under the cache lock, so it should
+// only queue the record, not wait for the disk. Returns false on failure.
+typedef bool (*txn_ring_writer)(const char* account_no, TxnRecord* entry, void* arg);
+
+// ring_size is clamped to [1, TXN_RING_MAX]. A budget too small for a single
+// ring disables the cache (every lookup goes to the loader).
+bool txn_ring_init(int ring_size, size_t budget_bytes);
+void txn_ring_shutdown(void);
+
+// Copies up to max of the account's newest transactions, oldest first, into
+// out, calling load to warm the ring on a miss. Returns the number copied,
+// or -1 if the loader failed.
+int txn_ring_get(const char* account_no, TxnRecord* out, int max, txn_ring_loader load);
+
+// Passes the transaction to write (with arg) and, if that succeeded and the
+// account is cached, appends it to the account's ring.
+bool txn_ring_record(const char* account_no, TxnRecord* entry, txn_ring_writer write, void* arg);
+
+// Forgets the account, e.g. after it has been deleted.
+void txn_ring_drop(const char* account_no);
+
+#endif
@@ -0,0 +1,20 @@
+// txnconvert: one-shot conversion of the text transactions.log into the
+// binary transactions.bin format. The server also converts it on the first
+// start without a binary log; this tool does it up front.
+//   ./txnconvert transactions/transactions.log transactions/transactions.bin
+#include "txn_log.h"
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <transactions.log> <transactions.bin>\n", argv[0]);
+        return 1;
+    }
+
+    size_t records = 0;
+    if (!txn_log_import_text(argv[1], argv[2], &records)) {
+        fprintf(stderr, "Failed to convert %s\n", argv[1]);
+        return 1;
+    }
+    printf("%s -> %s (%zu records)\n", argv[1], argv[2], records);
+    return 0;
+}